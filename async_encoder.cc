@@ -0,0 +1,120 @@
+#include "qt-rappor-client/async_encoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include <QFutureInterface>
+#include <QRunnable>
+#include <QThreadPool>
+
+namespace rappor {
+
+namespace {
+
+class FunctionTask : public QRunnable {
+ public:
+  explicit FunctionTask(std::function<void()> fn) : fn_(std::move(fn)) {}
+  void run() override { fn_(); }
+
+ private:
+  std::function<void()> fn_;
+};
+
+template <typename T>
+void Finish(QFutureInterface<T> promise, bool ok, const T& result) {
+  if (ok) {
+    promise.reportResult(result);
+  } else {
+    promise.reportCanceled();
+  }
+  promise.reportFinished();
+}
+
+// State shared by the chunks of one EncodeStringsAsync() call.  The last
+// chunk to finish reports the result.
+struct BatchState {
+  std::vector<std::string> values;
+  QVector<Bits> irrs;
+  std::atomic<int> pending{0};
+  std::atomic<bool> failed{false};
+  QFutureInterface<QVector<Bits>> promise;
+};
+
+}  // namespace
+
+AsyncEncoder::AsyncEncoder(const Encoder* encoder, QThreadPool* pool)
+    : encoder_(encoder),
+      pool_(pool ? pool : QThreadPool::globalInstance()) {
+}
+
+QFuture<Bits> AsyncEncoder::EncodeStringAsync(std::string value) const {
+  QFutureInterface<Bits> promise;
+  promise.reportStarted();
+  QFuture<Bits> future = promise.future();
+
+  const Encoder* encoder = encoder_;
+  pool_->start(new FunctionTask(
+      [encoder, promise, value = std::move(value)]() {
+        Bits irr = 0;
+        bool ok = encoder->EncodeString(value, &irr);
+        Finish(promise, ok, irr);
+      }));
+  return future;
+}
+
+QFuture<Bits> AsyncEncoder::EncodeBitsAsync(Bits bits) const {
+  QFutureInterface<Bits> promise;
+  promise.reportStarted();
+  QFuture<Bits> future = promise.future();
+
+  const Encoder* encoder = encoder_;
+  pool_->start(new FunctionTask([encoder, promise, bits]() {
+    Bits irr = 0;
+    bool ok = encoder->EncodeBits(bits, &irr);
+    Finish(promise, ok, irr);
+  }));
+  return future;
+}
+
+QFuture<QVector<Bits>> AsyncEncoder::EncodeStringsAsync(
+    std::vector<std::string> values) const {
+  auto state = std::make_shared<BatchState>();
+  state->promise.reportStarted();
+  QFuture<QVector<Bits>> future = state->promise.future();
+
+  const size_t count = values.size();
+  state->values = std::move(values);
+  state->irrs.resize(static_cast<int>(count));
+  if (count == 0) {
+    Finish(state->promise, true, state->irrs);
+    return future;
+  }
+
+  // One chunk per pool thread, so each thread hashes a contiguous run.
+  const size_t threads = std::max(1, pool_->maxThreadCount());
+  const size_t chunks = std::min(threads, count);
+  const size_t chunk_size = (count + chunks - 1) / chunks;
+  state->pending = static_cast<int>((count + chunk_size - 1) / chunk_size);
+
+  // Chunks write to disjoint ranges of the preallocated result.
+  const Encoder* encoder = encoder_;
+  Bits* irrs = state->irrs.data();
+  for (size_t begin = 0; begin < count; begin += chunk_size) {
+    size_t n = std::min(chunk_size, count - begin);
+    pool_->start(new FunctionTask([encoder, state, irrs, begin, n]() {
+      if (!encoder->EncodeStrings(state->values.data() + begin, n,
+                                  irrs + begin)) {
+        state->failed = true;
+      }
+      if (--state->pending == 0) {
+        Finish(state->promise, !state->failed, state->irrs);
+      }
+    }));
+  }
+  return future;
+}
+
+}  // namespace rappor
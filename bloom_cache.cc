@@ -0,0 +1,77 @@
+#include "qt-rappor-client/bloom_cache.h"
+
+namespace rappor {
+
+BloomCache::BloomCache(size_t max_entries)
+    : num_sets_(1), hits_(0), misses_(0) {
+  while (num_sets_ * kWays < max_entries) {
+    num_sets_ *= 2;
+  }
+  sets_.reset(new Set[num_sets_]);
+}
+
+BloomCache::~BloomCache() {
+}
+
+// FNV-1a over the value, mixed with the shape.
+uint64_t BloomCache::Hash(std::string_view value, const BloomShape& shape) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (char c : value) {
+    h = (h ^ static_cast<uint8_t>(c)) * 0x100000001b3ULL;
+  }
+  h ^= (static_cast<uint64_t>(shape.cohort) << 32) ^
+       (static_cast<uint64_t>(shape.num_bits) << 8) ^ shape.num_hashes;
+  h ^= h >> 29;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 32;
+  return h;
+}
+
+bool BloomCache::Lookup(std::string_view value, const BloomShape& shape,
+                        Bits* bloom) {
+  uint64_t hash = Hash(value, shape);
+  Set& set = sets_[hash & (num_sets_ - 1)];
+
+  std::unique_lock<std::mutex> lock(set.mutex, std::try_to_lock);
+  if (lock.owns_lock()) {
+    for (size_t i = 0; i < kWays; ++i) {
+      const Way& way = set.ways[i];
+      if (way.filled && way.hash == hash && way.shape == shape &&
+          way.value == value) {
+        set.next_victim = (i + 1) % kWays;  // keep the way just used
+        *bloom = way.bloom;
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+  }
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void BloomCache::Insert(std::string_view value, const BloomShape& shape,
+                        Bits bloom) {
+  uint64_t hash = Hash(value, shape);
+  Set& set = sets_[hash & (num_sets_ - 1)];
+
+  std::unique_lock<std::mutex> lock(set.mutex, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return;
+  }
+  size_t victim = set.next_victim;
+  for (size_t i = 0; i < kWays; ++i) {
+    if (!set.ways[i].filled) {
+      victim = i;
+      break;
+    }
+  }
+  Way& way = set.ways[victim];
+  way.filled = true;
+  way.hash = hash;
+  way.shape = shape;
+  way.bloom = bloom;
+  way.value.assign(value.data(), value.size());  // reuses the way's capacity
+  set.next_victim = (victim + 1) % kWays;
+}
+
+}  // namespace rappor
@@ -0,0 +1,269 @@
+#include "qt-rappor-client/chacha20.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define RAPPOR_CHACHA20_X86 1
+#include <immintrin.h>
+#endif
+
+namespace rappor {
+
+namespace {
+
+typedef void BlocksFunc(const uint32_t*, size_t, uint8_t*);
+
+inline uint32_t LoadLittleEndian32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) |
+         (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline void StoreLittleEndian32(uint32_t x, uint8_t* p) {
+  p[0] = static_cast<uint8_t>(x);
+  p[1] = static_cast<uint8_t>(x >> 8);
+  p[2] = static_cast<uint8_t>(x >> 16);
+  p[3] = static_cast<uint8_t>(x >> 24);
+}
+
+inline uint32_t Rotl(uint32_t x, int n) {
+  return (x << n) | (x >> (32 - n));
+}
+
+#define RAPPOR_CHACHA_QUARTER_ROUND(a, b, c, d) \
+  a += b; d = Rotl(d ^ a, 16);                  \
+  c += d; b = Rotl(b ^ c, 12);                  \
+  a += b; d = Rotl(d ^ a, 8);                   \
+  c += d; b = Rotl(b ^ c, 7);
+
+// Initial state: constants, key, block counter (word 12), nonce.
+void InitState(const uint8_t* key, const uint8_t* nonce, uint32_t counter,
+               uint32_t* state) {
+  state[0] = 0x61707865;
+  state[1] = 0x3320646e;
+  state[2] = 0x79622d32;
+  state[3] = 0x6b206574;
+  for (int i = 0; i < 8; ++i) {
+    state[4 + i] = LoadLittleEndian32(key + 4 * i);
+  }
+  state[12] = counter;
+  for (int i = 0; i < 3; ++i) {
+    state[13 + i] = LoadLittleEndian32(nonce + 4 * i);
+  }
+}
+
+// Writes num_blocks blocks, advancing the counter in state[12].
+void BlocksScalar(const uint32_t* state, size_t num_blocks, uint8_t* out) {
+  uint32_t input[16];
+  for (int i = 0; i < 16; ++i) {
+    input[i] = state[i];
+  }
+  for (size_t block = 0; block < num_blocks; ++block) {
+    uint32_t x[16];
+    for (int i = 0; i < 16; ++i) {
+      x[i] = input[i];
+    }
+    for (int round = 0; round < 10; ++round) {
+      RAPPOR_CHACHA_QUARTER_ROUND(x[0], x[4], x[8], x[12])
+      RAPPOR_CHACHA_QUARTER_ROUND(x[1], x[5], x[9], x[13])
+      RAPPOR_CHACHA_QUARTER_ROUND(x[2], x[6], x[10], x[14])
+      RAPPOR_CHACHA_QUARTER_ROUND(x[3], x[7], x[11], x[15])
+      RAPPOR_CHACHA_QUARTER_ROUND(x[0], x[5], x[10], x[15])
+      RAPPOR_CHACHA_QUARTER_ROUND(x[1], x[6], x[11], x[12])
+      RAPPOR_CHACHA_QUARTER_ROUND(x[2], x[7], x[8], x[13])
+      RAPPOR_CHACHA_QUARTER_ROUND(x[3], x[4], x[9], x[14])
+    }
+    for (int i = 0; i < 16; ++i) {
+      StoreLittleEndian32(x[i] + input[i], out + 4 * i);
+    }
+    out += kChaCha20BlockSize;
+    ++input[12];
+  }
+}
+
+#ifdef RAPPOR_CHACHA20_X86
+
+// The vector kernels keep word i of N consecutive blocks in lane j of x[i]
+// (block counter + j), run the rounds on all of them at once, then transpose
+// back to N contiguous 64-byte blocks.
+
+#define RAPPOR_CHACHA_VECTOR_QUARTER_ROUND(a, b, c, d) \
+  a = ADD(a, b); d = ROTL16(XOR(d, a));                \
+  c = ADD(c, d); b = ROTL(XOR(b, c), 12);              \
+  a = ADD(a, b); d = ROTL8(XOR(d, a));                 \
+  c = ADD(c, d); b = ROTL(XOR(b, c), 7);
+
+#define RAPPOR_CHACHA_VECTOR_DOUBLE_ROUND(x)                     \
+  RAPPOR_CHACHA_VECTOR_QUARTER_ROUND(x[0], x[4], x[8], x[12])    \
+  RAPPOR_CHACHA_VECTOR_QUARTER_ROUND(x[1], x[5], x[9], x[13])    \
+  RAPPOR_CHACHA_VECTOR_QUARTER_ROUND(x[2], x[6], x[10], x[14])   \
+  RAPPOR_CHACHA_VECTOR_QUARTER_ROUND(x[3], x[7], x[11], x[15])   \
+  RAPPOR_CHACHA_VECTOR_QUARTER_ROUND(x[0], x[5], x[10], x[15])   \
+  RAPPOR_CHACHA_VECTOR_QUARTER_ROUND(x[1], x[6], x[11], x[12])   \
+  RAPPOR_CHACHA_VECTOR_QUARTER_ROUND(x[2], x[7], x[8], x[13])    \
+  RAPPOR_CHACHA_VECTOR_QUARTER_ROUND(x[3], x[4], x[9], x[14])
+
+#define ADD(a, b) _mm_add_epi32(a, b)
+#define XOR(a, b) _mm_xor_si128(a, b)
+#define ROTL(a, n) _mm_or_si128(_mm_slli_epi32(a, n), _mm_srli_epi32(a, 32 - n))
+#define ROTL16(a) ROTL(a, 16)
+#define ROTL8(a) ROTL(a, 8)
+
+// Transposes words [i, i + 4) of 4 blocks and stores them.
+__attribute__((target("sse2")))
+inline void Store4x4(__m128i a, __m128i b, __m128i c, __m128i d,
+                     uint8_t* out) {
+  __m128i ab_lo = _mm_unpacklo_epi32(a, b);
+  __m128i cd_lo = _mm_unpacklo_epi32(c, d);
+  __m128i ab_hi = _mm_unpackhi_epi32(a, b);
+  __m128i cd_hi = _mm_unpackhi_epi32(c, d);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                   _mm_unpacklo_epi64(ab_lo, cd_lo));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + kChaCha20BlockSize),
+                   _mm_unpackhi_epi64(ab_lo, cd_lo));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * kChaCha20BlockSize),
+                   _mm_unpacklo_epi64(ab_hi, cd_hi));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 3 * kChaCha20BlockSize),
+                   _mm_unpackhi_epi64(ab_hi, cd_hi));
+}
+
+__attribute__((target("sse2")))
+void BlocksSse2(const uint32_t* state, size_t num_blocks, uint8_t* out) {
+  uint32_t counter = state[12];
+  for (; num_blocks >= 4; num_blocks -= 4, counter += 4) {
+    __m128i input[16];
+    for (int i = 0; i < 16; ++i) {
+      input[i] = _mm_set1_epi32(static_cast<int>(state[i]));
+    }
+    input[12] = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(counter)),
+                              _mm_set_epi32(3, 2, 1, 0));
+    __m128i x[16];
+    for (int i = 0; i < 16; ++i) {
+      x[i] = input[i];
+    }
+    for (int round = 0; round < 10; ++round) {
+      RAPPOR_CHACHA_VECTOR_DOUBLE_ROUND(x)
+    }
+    for (int i = 0; i < 16; ++i) {
+      x[i] = _mm_add_epi32(x[i], input[i]);
+    }
+    for (int i = 0; i < 16; i += 4) {
+      Store4x4(x[i], x[i + 1], x[i + 2], x[i + 3], out + 4 * i);
+    }
+    out += 4 * kChaCha20BlockSize;
+  }
+
+  uint32_t rest[16];
+  for (int i = 0; i < 16; ++i) {
+    rest[i] = state[i];
+  }
+  rest[12] = counter;
+  BlocksScalar(rest, num_blocks, out);
+}
+
+#undef ADD
+#undef XOR
+#undef ROTL
+#undef ROTL16
+#undef ROTL8
+
+#define ADD(a, b) _mm256_add_epi32(a, b)
+#define XOR(a, b) _mm256_xor_si256(a, b)
+#define ROTL(a, n) \
+  _mm256_or_si256(_mm256_slli_epi32(a, n), _mm256_srli_epi32(a, 32 - n))
+// Byte-aligned rotations are a single shuffle.
+#define ROTL16(a) _mm256_shuffle_epi8(a, rot16)
+#define ROTL8(a) _mm256_shuffle_epi8(a, rot8)
+
+__attribute__((target("avx2")))
+void BlocksAvx2(const uint32_t* state, size_t num_blocks, uint8_t* out) {
+  const __m256i rot16 = _mm256_setr_epi8(
+      2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+      2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+  const __m256i rot8 = _mm256_setr_epi8(
+      3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+      3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+
+  uint32_t counter = state[12];
+  for (; num_blocks >= 8; num_blocks -= 8, counter += 8) {
+    __m256i input[16];
+    for (int i = 0; i < 16; ++i) {
+      input[i] = _mm256_set1_epi32(static_cast<int>(state[i]));
+    }
+    input[12] = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(counter)),
+                                 _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256i x[16];
+    for (int i = 0; i < 16; ++i) {
+      x[i] = input[i];
+    }
+    for (int round = 0; round < 10; ++round) {
+      RAPPOR_CHACHA_VECTOR_DOUBLE_ROUND(x)
+    }
+    for (int i = 0; i < 16; ++i) {
+      x[i] = _mm256_add_epi32(x[i], input[i]);
+    }
+    // The low 128-bit lanes hold blocks 0-3, the high lanes blocks 4-7.
+    for (int i = 0; i < 16; i += 4) {
+      Store4x4(_mm256_castsi256_si128(x[i]), _mm256_castsi256_si128(x[i + 1]),
+               _mm256_castsi256_si128(x[i + 2]),
+               _mm256_castsi256_si128(x[i + 3]), out + 4 * i);
+      Store4x4(_mm256_extracti128_si256(x[i], 1),
+               _mm256_extracti128_si256(x[i + 1], 1),
+               _mm256_extracti128_si256(x[i + 2], 1),
+               _mm256_extracti128_si256(x[i + 3], 1),
+               out + 4 * kChaCha20BlockSize + 4 * i);
+    }
+    out += 8 * kChaCha20BlockSize;
+  }
+
+  uint32_t rest[16];
+  for (int i = 0; i < 16; ++i) {
+    rest[i] = state[i];
+  }
+  rest[12] = counter;
+  BlocksSse2(rest, num_blocks, out);
+}
+
+#undef ADD
+#undef XOR
+#undef ROTL
+#undef ROTL16
+#undef ROTL8
+
+BlocksFunc* SelectBlocks() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return BlocksAvx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return BlocksSse2;
+  }
+  return BlocksScalar;
+}
+
+#else
+
+BlocksFunc* SelectBlocks() {
+  return BlocksScalar;
+}
+
+#endif  // RAPPOR_CHACHA20_X86
+
+}  // namespace
+
+void ChaCha20KeystreamScalar(const uint8_t* key, const uint8_t* nonce,
+                             uint32_t counter, size_t num_blocks,
+                             uint8_t* out) {
+  uint32_t state[16];
+  InitState(key, nonce, counter, state);
+  BlocksScalar(state, num_blocks, out);
+}
+
+void ChaCha20Keystream(const uint8_t* key, const uint8_t* nonce,
+                       uint32_t counter, size_t num_blocks, uint8_t* out) {
+  static BlocksFunc* const blocks = SelectBlocks();
+  uint32_t state[16];
+  InitState(key, nonce, counter, state);
+  blocks(state, num_blocks, out);
+}
+
+}  // namespace rappor
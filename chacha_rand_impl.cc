@@ -0,0 +1,136 @@
+#include "qt-rappor-client/chacha_rand_impl.h"
+
+#include "qt-rappor-client/bitsliced_mask.h"
+#include "qt-rappor-client/chacha20.h"
+#include "qt-rappor-client/os_random.h"
+
+#include <cstring>
+
+namespace rappor {
+
+namespace {
+
+const size_t kRefillBlocks = 8;
+const size_t kRefillBytes = kRefillBlocks * kChaCha20BlockSize;
+const int kBufferWords = (kRefillBytes - kChaCha20KeySize) / 4;
+
+}  // namespace
+
+struct ChaChaRand::Generator
+{
+    explicit Generator(bool reseeds)
+    {
+        if (reseeds) {
+            Reseed();
+        }
+    }
+
+    ~Generator()
+    {
+        volatile uint8_t* key = m_key;
+        for (size_t i = 0; i < kChaCha20KeySize; ++i) {
+            key[i] = 0;
+        }
+    }
+
+    void Reseed()
+    {
+        OsRandom(m_key, kChaCha20KeySize);
+        m_next = kBufferWords;
+        m_sinceReseed = 0;
+        m_forkGeneration = ForkGeneration();
+    }
+
+    // Called before each use of a generator that reseeds.
+    void CheckReseed()
+    {
+        if (m_forkGeneration != ForkGeneration() || m_sinceReseed >= kReseedBytes) {
+            Reseed();
+        }
+    }
+
+    void Refill()
+    {
+        static const uint8_t kNonce[kChaCha20NonceSize] = {};
+        alignas(32) uint8_t block[kRefillBytes];
+        ChaCha20Keystream(m_key, kNonce, 0, kRefillBlocks, block);
+        std::memcpy(m_key, block, kChaCha20KeySize);
+        std::memcpy(m_words, block + kChaCha20KeySize, sizeof(m_words));
+        m_next = 0;
+        m_sinceReseed += sizeof(m_words);
+    }
+
+    Bits NextWord()
+    {
+        if (m_next == kBufferWords) {
+            Refill();
+        }
+        return m_words[m_next++];
+    }
+
+    Bits BitslicedMask(uint32_t threshold)
+    {
+        return rappor::BitslicedMask(threshold, [this] { return NextWord(); });
+    }
+
+    uint8_t m_key[kChaCha20KeySize] = {};
+    uint32_t m_words[kBufferWords];
+    int m_next = kBufferWords;
+    uint64_t m_sinceReseed = 0;
+    uint32_t m_forkGeneration = 0;
+};
+
+ChaChaRand::ChaChaRand()
+{
+    RegisterForkHandler();
+}
+
+// For unit testing only
+ChaChaRand::ChaChaRand(uint64_t seed)
+{
+    m_generator = std::make_unique<Generator>(false);
+    for (size_t i = 0; i < sizeof(seed); ++i) {
+        m_generator->m_key[i] = static_cast<uint8_t>(seed >> (8 * i));
+    }
+}
+
+ChaChaRand::~ChaChaRand()
+{
+}
+
+template <typename Fn>
+void ChaChaRand::WithGenerator(Fn fn) const
+{
+    if (m_generator) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        fn(*m_generator);
+        return;
+    }
+
+    thread_local Generator threadGenerator(true);
+    threadGenerator.CheckReseed();
+    fn(threadGenerator);
+}
+
+void ChaChaRand::GetMask(float prob, int num_bits, Bits* mask_out) const
+{
+    WithGenerator([&](Generator& generator) {
+        *mask_out = generator.BitslicedMask(Threshold128(prob)) & LowBits(num_bits);
+    });
+}
+
+void ChaChaRand::GetMasks(float prob_p, float prob_q, int num_bits,
+                          Bits* p_out, Bits* q_out) const
+{
+    const uint32_t p_threshold = Threshold128(prob_p);
+    const uint32_t q_threshold = Threshold128(prob_q);
+
+    WithGenerator([&](Generator& generator) {
+        for (int i = 0; num_bits > 0; ++i, num_bits -= 32) {
+            p_out[i] = generator.BitslicedMask(p_threshold) & LowBits(num_bits);
+            q_out[i] = generator.BitslicedMask(q_threshold) & LowBits(num_bits);
+        }
+    });
+}
+
+}  // namespace rappor
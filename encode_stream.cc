@@ -0,0 +1,135 @@
+#include "qt-rappor-client/encode_stream.h"
+
+#include <QIODevice>
+#include <QLoggingCategory>
+
+#include "qt-rappor-client/qt_hash_impl.h"
+
+Q_DECLARE_LOGGING_CATEGORY(rapporLog)
+
+namespace rappor {
+
+// Device reads go through a stack buffer of this size.
+static const qint64 kReadChunkSize = 4096;
+// Largest Encoder::BloomHash() output.
+static const size_t kMaxBloomHashBytes = 64;
+
+EncodeStream::EncodeStream(const Encoder* encoder)
+    : encoder_(encoder),
+      incremental_(encoder->hash_into_ == Md5Into) {
+  BeginValue();
+}
+
+void EncodeStream::BeginValue() {
+  if (incremental_) {
+    md5_ = Md5Context();
+    md5_.Update(encoder_->cohort_str_.data(), encoder_->cohort_str_.size());
+  } else {
+    value_.clear();
+  }
+}
+
+void EncodeStream::Update(std::string_view chunk) {
+  if (incremental_) {
+    md5_.Update(chunk.data(), chunk.size());
+  } else {
+    value_.append(chunk);
+  }
+}
+
+bool EncodeStream::Update(QIODevice* device) {
+  // On a sequential device read() returning 0 only means no data has
+  // arrived yet, so it can't mark the end of the value.
+  if (device->isSequential()) {
+    qCDebug(rapporLog, "Streaming from a sequential device isn't supported");
+    return false;
+  }
+  char buffer[kReadChunkSize];
+  for (;;) {
+    qint64 n = device->read(buffer, kReadChunkSize);
+    if (n < 0) {
+      qCDebug(rapporLog, "Reading the value failed");
+      return false;
+    }
+    if (n == 0) {
+      return true;
+    }
+    Update(std::string_view(buffer, static_cast<size_t>(n)));
+  }
+}
+
+bool EncodeStream::FinishHash(uint8_t* hash_output, size_t* hash_size) {
+  bool ok;
+  if (incremental_) {
+    md5_.Final(hash_output);
+    *hash_size = Md5Context::kDigestSize;
+    ok = true;
+  } else {
+    ok = encoder_->BloomHash(value_, hash_output, hash_size);
+  }
+  BeginValue();
+  if (!ok) {
+    qCDebug(rapporLog, "Hash function failed");
+  }
+  return ok;
+}
+
+bool EncodeStream::_FinishInternal(Bits* bloom_out, Bits* prr_out,
+                                   Bits* irr_out) {
+  uint8_t hash_output[kMaxBloomHashBytes];
+  size_t hash_size;
+  if (!FinishHash(hash_output, &hash_size) ||
+      !encoder_->BloomFromHash(hash_output, hash_size, bloom_out)) {
+    return false;
+  }
+  return encoder_->_EncodeBitsInternal(*bloom_out, prr_out, irr_out);
+}
+
+bool EncodeStream::Finish(Bits* irr_out) {
+  Bits unused_bloom;
+  Bits unused_prr;
+  return _FinishInternal(&unused_bloom, &unused_prr, irr_out);
+}
+
+template <int N>
+bool EncodeStream::_FinishInternal(BasicBits<N>* bloom_out,
+                                   BasicBits<N>* prr_out,
+                                   BasicBits<N>* irr_out) {
+  uint8_t hash_output[kMaxBloomHashBytes];
+  size_t hash_size;
+  if (!FinishHash(hash_output, &hash_size)) {
+    return false;
+  }
+  const int num_bits = encoder_->params_.num_bits();
+  if (num_bits > N) {
+    qCDebug(rapporLog, "num_bits (%d) doesn't fit in a %d-bit report",
+        num_bits, N);
+    return false;
+  }
+  if (!encoder_->BloomFromHash(hash_output, hash_size, bloom_out)) {
+    return false;
+  }
+  return encoder_->_EncodeBitsInternal(*bloom_out, prr_out, irr_out);
+}
+
+template <int N>
+bool EncodeStream::Finish(BasicBits<N>* irr_out) {
+  BasicBits<N> unused_bloom;
+  BasicBits<N> unused_prr;
+  return _FinishInternal(&unused_bloom, &unused_prr, irr_out);
+}
+
+#define RAPPOR_INSTANTIATE_WIDE_STREAM(N)                                   \
+  template QT_RAPPOR_EXPORT bool EncodeStream::Finish(BasicBits<N>*);       \
+  template QT_RAPPOR_EXPORT bool EncodeStream::_FinishInternal(             \
+      BasicBits<N>*, BasicBits<N>*, BasicBits<N>*);
+
+RAPPOR_INSTANTIATE_WIDE_STREAM(64)
+RAPPOR_INSTANTIATE_WIDE_STREAM(128)
+RAPPOR_INSTANTIATE_WIDE_STREAM(256)
+RAPPOR_INSTANTIATE_WIDE_STREAM(512)
+RAPPOR_INSTANTIATE_WIDE_STREAM(1024)
+
+#undef RAPPOR_INSTANTIATE_WIDE_STREAM
+
+}  // namespace rappor
@@ -13,8 +13,15 @@
 // limitations under the License.
 
 #include "qt-rappor-client/encoder.h"
+#include "qt-rappor-client/bloom_cache.h"
+#include "qt-rappor-client/prr_cache.h"
+#include "qt-rappor-client/prr_masks.h"
 #include "qt-rappor-client/qt_hash_impl.h"
+#include "qt-rappor-client/sha256.h"
 
+#include <string.h>
+#include <algorithm>
+#include <utility>
 #include <vector>
 
 #include <QLoggingCategory>
@@ -31,6 +38,13 @@ static const int kMaxBits = 32;
 // Can't be more than the number of bytes in MD5.
 static const int kMaxHashes = 16;
 
+// The byte-vector Bloom filter uses up to 4 bytes of hash per hash function.
+static const int kMaxBloomHashBytes = 4 * kMaxHashes;
+
+// Widest report for HmacDrbg encoders.  The byte-vector API goes through
+// BasicBits, which is instantiated up to this size.
+static const int kMaxWideBits = 1024;
+
 // Probabilities should be in the interval [0.0, 1.0].
 static void CheckValidProbability(float prob, const char* var_name) {
   if (prob < 0.0f || prob > 1.0f) {
@@ -53,104 +67,307 @@ static std::string ToBigEndian(uint32_t u) {
   return result;
 }
 
+// Values per MakeBloomFilters() call in the batch encoders; one group of the
+// multi-buffer MD5.
+static const size_t kBloomBatchSize = 16;
+
 static const char* kHmacCohortPrefix = "\x00";
 static const char* kHmacPrrPrefix = "\x01";
 
+// Per-thread scratch buffers for hash inputs and outputs.  They only grow, so
+// once they have reached the size of the largest value seen, encoding doesn't
+// allocate.
+namespace {
+struct Scratch {
+  std::string hash_input;
+  std::string hmac_input;
+  std::vector<uint8_t> digest;  // output of legacy HashFunc/HmacFunc
+  std::string utf8;  // QStringView values
+};
+}  // namespace
+
+static Scratch& GetScratch() {
+  thread_local Scratch scratch;
+  return scratch;
+}
+
+// Append UTF-16 as UTF-8.  Unpaired surrogates become U+FFFD, as in
+// QString::toUtf8().
+static void AppendUtf8(const char16_t* utf16, size_t size, std::string* out) {
+  for (size_t i = 0; i < size; ++i) {
+    uint32_t c = utf16[i];
+    if (c >= 0xd800 && c < 0xe000) {
+      if (c < 0xdc00 && i + 1 < size && utf16[i + 1] >= 0xdc00 &&
+          utf16[i + 1] < 0xe000) {
+        c = 0x10000 + ((c - 0xd800) << 10) + (utf16[i + 1] - 0xdc00);
+        ++i;
+      } else {
+        c = 0xfffd;
+      }
+    }
+
+    if (c < 0x80) {
+      out->push_back(static_cast<char>(c));
+    } else if (c < 0x800) {
+      out->push_back(static_cast<char>(0xc0 | (c >> 6)));
+      out->push_back(static_cast<char>(0x80 | (c & 0x3f)));
+    } else if (c < 0x10000) {
+      out->push_back(static_cast<char>(0xe0 | (c >> 12)));
+      out->push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3f)));
+      out->push_back(static_cast<char>(0x80 | (c & 0x3f)));
+    } else {
+      out->push_back(static_cast<char>(0xf0 | (c >> 18)));
+      out->push_back(static_cast<char>(0x80 | ((c >> 12) & 0x3f)));
+      out->push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3f)));
+      out->push_back(static_cast<char>(0x80 | (c & 0x3f)));
+    }
+  }
+}
+
 
 //
 // Encoder
 //
 
-uint32_t Encoder::AssignCohort(const Deps& deps, int num_cohorts) {
-  std::vector<uint8_t> sha256;
-  if (!deps.hmac_func_(deps.client_secret_, kHmacCohortPrefix, &sha256)) {
-    qFatal("HMAC failed");
-  }
+void Encoder::LogDebug(const char* message, const char* detail) {
+  qCDebug(rapporLog, "%s%s", message, detail);
+}
+
+void Encoder::LogWarning(const char* message, const char* detail) {
+  qCWarning(rapporLog, "%s%s", message, detail);
+}
 
-  // Either we are using SHA256 to have exactly 32 bytes,
-  // or we're using HmacDrbg for any number of bytes.
-  if ((sha256.size() == kMaxBits)
-      || (deps.hmac_func_ == rappor::HmacDrbg)) {
-    // Hash size ok.
+uint32_t Encoder::CohortHash(const Deps& deps) {
+  uint8_t sha256[kMaxBits];
+  if (deps.hmac_into_func_) {
+    HmacDigest digest;
+    if (!deps.hmac_into_func_(deps.client_secret_, kHmacCohortPrefix,
+                              &digest)) {
+      qFatal("HMAC failed");
+    }
+    memcpy(sha256, digest.data(), sizeof(sha256));
   } else {
-    qFatal("Bad hash size.");
+    std::vector<uint8_t> output;
+    if (!deps.hmac_func_(deps.client_secret_, kHmacCohortPrefix, &output)) {
+      qFatal("HMAC failed");
+    }
+
+    // Either we are using SHA256 to have exactly 32 bytes,
+    // or we're using HmacDrbg for any number of bytes.
+    if ((output.size() == kMaxBits)
+        || (deps.hmac_func_ == rappor::HmacDrbg)) {
+      // Hash size ok.
+    } else {
+      qFatal("Bad hash size.");
+    }
+    memcpy(sha256, output.data(), sizeof(uint32_t));
   }
 
   // Interpret first 4 bytes of sha256 as a uint32_t.
-  uint32_t c = *(reinterpret_cast<uint32_t*>(sha256.data()));
+  uint32_t c;
+  memcpy(&c, sha256, sizeof(c));
+  return c;
+}
+
+uint32_t Encoder::AssignCohort(const Deps& deps, int num_cohorts) {
   // e.g. for 128 cohorts, 0x80 - 1 = 0x7f
   uint32_t cohort_mask = num_cohorts - 1;
-  return c & cohort_mask;
+  return CohortHash(deps) & cohort_mask;
+}
+
+struct Encoder::ClientState {
+  ClientState(const std::string& encoder_id, const Deps& deps)
+      : encoder_id(encoder_id), deps(deps) {
+  }
+
+  const std::string encoder_id;
+  const Deps deps;
+  std::unique_ptr<HmacSha256Context> keyed_hmac;
+};
+
+std::shared_ptr<const Encoder::ClientState> Encoder::MakeClientState(
+    const std::string& encoder_id, const Deps& deps) {
+  auto state = std::make_shared<ClientState>(encoder_id, deps);
+  if (UsesHmacSha256(deps)) {
+    state->keyed_hmac =
+        std::make_unique<HmacSha256Context>(deps.client_secret_);
+  }
+  return state;
 }
 
 Encoder::Encoder(const std::string& encoder_id, const Params& params,
                  const Deps& deps)
-    : encoder_id_(encoder_id),
+    : own_state_(MakeClientState(encoder_id, deps)),
+      encoder_id_(own_state_->encoder_id),
       params_(params),
-      deps_(deps),
+      deps_(&own_state_->deps),
       cohort_(AssignCohort(deps, params.num_cohorts_)),
       cohort_str_(ToBigEndian(cohort_)) {
+  Init(own_state_->keyed_hmac.get());
+}
+
+Encoder::Encoder(std::string_view encoder_id, const Params& params,
+                 const Deps& deps, uint32_t cohort_hash,
+                 const HmacSha256Context* keyed_hmac)
+    : encoder_id_(encoder_id),
+      params_(params),
+      deps_(&deps),
+      cohort_(cohort_hash & (params.num_cohorts_ - 1)),
+      cohort_str_(ToBigEndian(cohort_)) {
+  Init(keyed_hmac);
+}
 
-  if (params_.num_bits_ <= 0) {
+void Encoder::CheckParams(const Params& params, const Deps& deps) {
+  if (params.num_bits_ <= 0) {
     qFatal("num_bits must be positive");
   }
-  if (params_.num_hashes_ <= 0) {
+  if (params.num_hashes_ <= 0) {
     qFatal("num_hashes must be positive");
   }
-  if (params_.num_cohorts_ <= 0) {
+  if (params.num_cohorts_ <= 0) {
     qFatal("num_cohorts must be positive");
   }
 
   // Check Maximum values.
-  if (deps_.hmac_func_ == rappor::HmacDrbg) {
+  if (deps.hmac_func_ == rappor::HmacDrbg) {
     // Using HmacDrbg
-    if (params_.num_bits_ % 8 != 0) {
+    if (params.num_bits_ % 8 != 0) {
       qFatal("num_bits (%d) must be divisible by 8 when using HmacDrbg.",
           params.num_bits_);
     }
+    if (params.num_bits_ > kMaxWideBits) {
+        qFatal("num_bits (%d) can't be greater than %d", params.num_bits_,
+            kMaxWideBits);
+    }
   } else {
     // Using SHA256
-    if (params_.num_bits_ > kMaxBits) {
-        qFatal("num_bits (%d) can't be greater than %d", params_.num_bits_,
+    if (params.num_bits_ > kMaxBits) {
+        qFatal("num_bits (%d) can't be greater than %d", params.num_bits_,
             kMaxBits);
     }
   }
 
-  if (params_.num_hashes_ > kMaxHashes) {
-    qFatal("num_hashes (%d) can't be greater than %d", params_.num_hashes_,
+  if (params.num_hashes_ > kMaxHashes) {
+    qFatal("num_hashes (%d) can't be greater than %d", params.num_hashes_,
         kMaxHashes);
   }
-  int m = params_.num_cohorts_;
+  int m = params.num_cohorts_;
   if ((m & (m - 1)) != 0) {
     qFatal("num_cohorts (%d) must be a power of 2 (and not 0)", m);
   }
   // TODO: check max cohorts?
 
-  CheckValidProbability(params_.prob_f_, "prob_f");
-  CheckValidProbability(params_.prob_p_, "prob_p");
-  CheckValidProbability(params_.prob_q_, "prob_q");
+  CheckValidProbability(params.prob_f_, "prob_f");
+  CheckValidProbability(params.prob_p_, "prob_p");
+  CheckValidProbability(params.prob_q_, "prob_q");
 }
 
-bool Encoder::MakeBloomFilter(const std::string& value, Bits* bloom_out) const {
-  const int num_bits = params_.num_bits_;
-  const int num_hashes = params_.num_hashes_;
+void Encoder::Init(const HmacSha256Context* keyed_hmac) {
+  CheckParams(params_, *deps_);
 
-  Bits bloom = 0;
+  // Our own hash functions have allocation-free versions; use them even if
+  // the application passed the std::vector ones.
+  hash_into_ = deps_->hash_into_func_;
+  if (deps_->hash_func_ == rappor::Md5) {
+    hash_into_ = rappor::Md5Into;
+  }
+  hmac_into_ = UsesHmacSha256(*deps_) ? rappor::HmacSha256Into
+                                      : deps_->hmac_into_func_;
+
+  // Every PRR HMAC starts with the same key and prefix; only the last 4
+  // bytes differ.  Absorb the common part once.
+  prr_key_ = nullptr;
+  if (hmac_into_ == rappor::HmacSha256Into) {
+    prr_key_ = keyed_hmac;
+    prr_inner_ = keyed_hmac->inner();
+    prr_inner_.Update(kHmacPrrPrefix, 1);
+    prr_inner_.Update(encoder_id_.data(), encoder_id_.size());
+  }
+}
+
+bool Encoder::UsesHmacSha256(const Deps& deps) {
+  return deps.hmac_func_ == rappor::HmacSha256 ||
+         deps.hmac_into_func_ == rappor::HmacSha256Into;
+}
 
+bool Encoder::BloomHash(std::string_view value, uint8_t* hash_output,
+                        size_t* hash_size) const {
   // 4 byte cohort string + true value
-  std::string hash_input(cohort_str_ + value);
+  std::string& hash_input = GetScratch().hash_input;
+  hash_input.assign(cohort_str_);
+  hash_input.append(value);
+
+  if (hash_into_) {
+    HashDigest digest;
+    if (!hash_into_(hash_input, &digest)) {
+      return false;
+    }
+    memcpy(hash_output, digest.data(), digest.size());
+    *hash_size = digest.size();
+    return true;
+  }
 
-  // First do hashing.
-  std::vector<uint8_t> hash_output;
-  deps_.hash_func_(hash_input, &hash_output);
+  std::vector<uint8_t>& digest = GetScratch().digest;
+  if (!deps_->hash_func_(hash_input, &digest)) {
+    return false;
+  }
+  *hash_size = std::min(digest.size(), static_cast<size_t>(kMaxBloomHashBytes));
+  memcpy(hash_output, digest.data(), *hash_size);
+  return true;
+}
+
+bool Encoder::PrrHmac(const std::string& hmac_value, uint8_t* output,
+                      size_t output_size) const {
+  if (deps_->hmac_func_ == rappor::HmacDrbg) {
+    return HmacDrbgInto(deps_->client_secret_, hmac_value, output, output_size);
+  }
+
+  if (hmac_into_) {
+    HmacDigest digest;
+    if (output_size != digest.size()) {
+      qCDebug(rapporLog, "Needed %zu bytes from Hmac function, received %zu "
+          "bytes.", output_size, digest.size());
+      return false;
+    }
+    if (!hmac_into_(deps_->client_secret_, hmac_value, &digest)) {
+      return false;
+    }
+    memcpy(output, digest.data(), digest.size());
+    return true;
+  }
+
+  std::vector<uint8_t>& digest = GetScratch().digest;
+  digest.resize(output_size);  // Signal to HmacDrbg about desired output size.
+  deps_->hmac_func_(deps_->client_secret_, hmac_value, &digest);
+  if (digest.size() != output_size) {
+    qCDebug(rapporLog, "Needed %zu bytes from Hmac function, received %zu "
+        "bytes.", output_size, digest.size());
+    return false;
+  }
+  memcpy(output, digest.data(), output_size);
+  return true;
+}
+
+BloomShape Encoder::bloom_shape() const {
+  return BloomShape{
+      cohort_, params_.num_bits_, params_.num_hashes_,
+      hash_into_ ? reinterpret_cast<uintptr_t>(hash_into_)
+                 : reinterpret_cast<uintptr_t>(deps_->hash_func_)};
+}
+
+bool Encoder::BloomFromHash(const uint8_t* hash_output, size_t hash_size,
+                            Bits* bloom_out) const {
+  const int num_bits = params_.num_bits_;
+  const int num_hashes = params_.num_hashes_;
 
   // Error check
-  if (hash_output.size() < static_cast<size_t>(num_hashes)) {
+  if (hash_size < static_cast<size_t>(num_hashes)) {
     qCDebug(rapporLog, "Hash function didn't return enough bytes");
     return false;
   }
 
   // To determine which bit to set in the bloom filter, use a byte of the MD5.
+  Bits bloom = 0;
   for (int i = 0; i < num_hashes; ++i) {
     int bit_to_set = hash_output[i] % num_bits;
     bloom |= 1 << bit_to_set;
@@ -160,66 +377,66 @@ bool Encoder::MakeBloomFilter(const std::string& value, Bits* bloom_out) const {
   return true;
 }
 
-// Write a Bloom filter into a vector of bytes, used for num_bits > 32.
-bool Encoder::MakeBloomFilter(const std::string& value,
-                              std::vector<uint8_t>* bloom_out) const {
-  const int num_bits = params_.num_bits_;
-  const int num_hashes = params_.num_hashes_;
-
-  bloom_out->resize(params_.num_bits_ / 8, 0);
-
-  // Generate the hash.
-  std::vector<uint8_t> hash_output;
-  deps_.hash_func_(std::string(cohort_str_ + value), &hash_output);
-
-  // Check that we have enough bytes of hash available.
-  int exponent = 0;
-  int bytes_needed = 0;
-  while ((1 << exponent) < num_bits) {
-    exponent++;
+bool Encoder::MakeBloomFilter(std::string_view value, Bits* bloom_out) const {
+  BloomShape shape = {};
+  if (bloom_cache_) {
+    shape = bloom_shape();
+    if (bloom_cache_->Lookup(value, shape, bloom_out)) {
+      return true;
+    }
   }
-  bytes_needed = ((exponent - 1) / 8) + 1;
-  if (bytes_needed > 4) {
-    qCDebug(rapporLog, "Can only use 4 bytes of hash at a time, needed %d "
-        "to address %d bits.", bytes_needed, num_bits);
+
+  // First do hashing.
+  uint8_t hash_output[kMaxBloomHashBytes];
+  size_t hash_size;
+  if (!BloomHash(value, hash_output, &hash_size)) {
+    qCDebug(rapporLog, "Hash function failed");
     return false;
   }
-  if (hash_output.size() < static_cast<size_t>(bytes_needed * num_hashes)) {
-    qCDebug(rapporLog, "Hash function returned %zu bytes, but we needed "
-        "%d bytes * %d hashes. Choose lower num_hashes or "
-        "a different hash function.",
-        hash_output.size(), bytes_needed, num_hashes);
+  Bits bloom;
+  if (!BloomFromHash(hash_output, hash_size, &bloom)) {
     return false;
   }
 
-  // To determine which bit to set in the Bloom filter, use 1 or more
-  // bytes of the MD5.
-  int hash_byte = 0;
-  for (int i = 0; i < num_hashes; ++i) {
-    int bit_to_set = 0;
-    for (int j = 0; j < bytes_needed; ++j) {
-      bit_to_set |= hash_output[hash_byte] << (j * 8);
-      ++hash_byte;
-    }
-    bit_to_set %= num_bits;
-    // Start at end of array to be consistent with the Bits implementation.
-    int index = (bloom_out->size() - 1) - (bit_to_set / 8);
-    (*bloom_out)[index] |= 1 << (bit_to_set % 8);
+  if (bloom_cache_) {
+    bloom_cache_->Insert(value, shape, bloom);
   }
+
+  *bloom_out = bloom;
   return true;
 }
 
+bool Encoder::PrrDigest(const Bits bits, uint8_t* sha256) const {
+  const char bits_str[4] = {
+    static_cast<char>(bits >> 24), static_cast<char>(bits >> 16),
+    static_cast<char>(bits >> 8), static_cast<char>(bits)
+  };
+
+  if (prr_key_) {
+    Sha256Context inner(prr_inner_);  // copy of the midstate
+    inner.Update(bits_str, sizeof(bits_str));
+    prr_key_->Final(&inner, sha256);
+    return true;
+  }
+
+  std::string& hmac_value = GetScratch().hmac_input;
+  hmac_value.assign(kHmacPrrPrefix);
+  hmac_value.append(encoder_id_);
+  hmac_value.append(bits_str, sizeof(bits_str));
+  return PrrHmac(hmac_value, sha256, kMaxBits);
+}
+
 // Helper method for PRR
 bool Encoder::GetPrrMasks(const Bits bits, Bits* uniform_out,
                           Bits* f_mask_out) const {
+  if (prr_cache_ && prr_cache_->Lookup(bits, uniform_out, f_mask_out)) {
+    return true;
+  }
+
   // Create HMAC(secret, value), and use its bits to construct f_mask and
   // uniform bits.
-  std::vector<uint8_t> sha256;
-
-  std::string hmac_value = kHmacPrrPrefix + encoder_id_ + ToBigEndian(bits);
-
-  deps_.hmac_func_(deps_.client_secret_, hmac_value, &sha256);
-  if (sha256.size() != kMaxBits) {  // sanity check
+  uint8_t sha256[kMaxBits];
+  if (!PrrDigest(bits, sha256)) {
     return false;
   }
 
@@ -230,18 +447,15 @@ bool Encoder::GetPrrMasks(const Bits bits, Bits* uniform_out,
 
   uint8_t threshold128 = static_cast<uint8_t>(params_.prob_f_ * 128);
 
-  Bits uniform = 0;
-  Bits f_mask = 0;
-
-  for (int i = 0; i < params_.num_bits_; ++i) {
-    uint8_t byte = sha256[i];
+  uint64_t uniform_word;
+  uint64_t f_mask_word;
+  ExtractPrrMasks(sha256, params_.num_bits_, threshold128, &uniform_word,
+                  &f_mask_word);
+  Bits uniform = static_cast<Bits>(uniform_word);
+  Bits f_mask = static_cast<Bits>(f_mask_word);
 
-    uint8_t u_bit = byte & 0x01;  // 1 bit of entropy
-    uniform |= (u_bit << i);  // maybe set bit in mask
-
-    uint8_t rand128 = byte >> 1;  // 7 bits of entropy
-    uint8_t noise_bit = (rand128 < threshold128);
-    f_mask |= (noise_bit << i);  // maybe set bit in mask
+  if (prr_cache_) {
+    prr_cache_->Insert(bits, uniform, f_mask);
   }
 
   *uniform_out = uniform;
@@ -249,6 +463,12 @@ bool Encoder::GetPrrMasks(const Bits bits, Bits* uniform_out,
   return true;
 }
 
+// Helper method for IRR.  May throw from std::random.
+void Encoder::GetIrrMasks(Bits* p_bits, Bits* q_bits) const {
+  deps_->irr_rand_->GetMasks(params_.prob_p_, params_.prob_q_,
+                            params_.num_bits_, p_bits, q_bits);
+}
+
 bool Encoder::_EncodeBitsInternal(const Bits bits, Bits* prr_out,
                                   Bits* irr_out) const try {
   // Compute Permanent Randomized Response (PRR).
@@ -266,8 +486,7 @@ bool Encoder::_EncodeBitsInternal(const Bits bits, Bits* prr_out,
 
   Bits p_bits;
   Bits q_bits;
-  deps_.irr_rand_->GetMask(params_.prob_p_, params_.num_bits_, &p_bits);
-  deps_.irr_rand_->GetMask(params_.prob_q_, params_.num_bits_, &q_bits);
+  GetIrrMasks(&p_bits, &q_bits);
 
   Bits irr = (p_bits & ~prr) | (q_bits & prr);
   *irr_out = irr;
@@ -278,7 +497,7 @@ bool Encoder::_EncodeBitsInternal(const Bits bits, Bits* prr_out,
   return false;
 }
 
-bool Encoder::_EncodeStringInternal(const std::string& value, Bits* bloom_out,
+bool Encoder::_EncodeStringInternal(std::string_view value, Bits* bloom_out,
     Bits* prr_out, Bits* irr_out) const {
   if (!MakeBloomFilter(value, bloom_out)) {
     qCDebug(rapporLog, "Bloom filter calculation failed");
@@ -292,49 +511,258 @@ bool Encoder::EncodeBits(const Bits bits, Bits* irr_out) const {
   return _EncodeBitsInternal(bits, &unused_prr, irr_out);
 }
 
-bool Encoder::EncodeString(const std::string& value, Bits* irr_out) const {
+bool Encoder::EncodeString(std::string_view value, Bits* irr_out) const {
   Bits unused_bloom;
   Bits unused_prr;
   return _EncodeStringInternal(value, &unused_bloom, &unused_prr, irr_out);
 }
 
-static uint8_t shifted(const Bits& bits, const int& index) {
-  // For an array of bytes, select the appopriate byte from a 4-byte
-  // integer value. Bytes are enumerated in big-endian order, i.e.
-  // index = 0 is the MSB, index = 3 is the LSB.
-  int shift = 8 * (3 - (index % 4)); // Byte 0 shifts by 24 bits, 1 by 16, etc.
-  return (uint8_t)((bits >> shift) & 0xFF);  // Return the correct byte.
+bool Encoder::EncodeString(QStringView value, Bits* irr_out) const {
+  std::string& utf8 = GetScratch().utf8;
+  utf8.clear();
+  AppendUtf8(value.utf16(), value.size(), &utf8);
+  return EncodeString(std::string_view(utf8), irr_out);
+}
+
+bool Encoder::EncodeUtf8(const QByteArray& value, Bits* irr_out) const {
+  return EncodeString(std::string_view(value.constData(), value.size()),
+                      irr_out);
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+bool Encoder::EncodeUtf8(QByteArrayView value, Bits* irr_out) const {
+  return EncodeString(std::string_view(value.data(), value.size()), irr_out);
+}
+#endif
+
+template <typename String>
+bool Encoder::MakeBloomFilters(const String* values, size_t count,
+                               Bits* blooms_out) const {
+  if (hash_into_ != rappor::Md5Into || bloom_cache_) {
+    for (size_t i = 0; i < count; ++i) {
+      if (!MakeBloomFilter(values[i], &blooms_out[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Lay the cohort_str_ + value inputs out back to back and hash them
+  // together through the multi-buffer MD5.
+  std::string& hash_input = GetScratch().hash_input;
+  hash_input.clear();
+  size_t ends[kBloomBatchSize];
+  for (size_t i = 0; i < count; ++i) {
+    hash_input.append(cohort_str_);
+    hash_input.append(values[i].data(), values[i].size());
+    ends[i] = hash_input.size();
+  }
+  std::string_view inputs[kBloomBatchSize];
+  for (size_t i = 0, begin = 0; i < count; begin = ends[i++]) {
+    inputs[i] = std::string_view(hash_input).substr(begin, ends[i] - begin);
+  }
+  HashDigest digests[kBloomBatchSize];
+  if (!Md5Batch(inputs, count, digests)) {
+    return false;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (!BloomFromHash(digests[i].data(), digests[i].size(), &blooms_out[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename String>
+bool Encoder::EncodeStringsImpl(const String* values, size_t count,
+                                Bits* bloom_out, Bits* prr_out,
+                                Bits* irr_out) const {
+  for (size_t start = 0; start < count; start += kBloomBatchSize) {
+    const size_t n = std::min(kBloomBatchSize, count - start);
+    Bits blooms[kBloomBatchSize];
+    if (!MakeBloomFilters(values + start, n, blooms)) {
+      qCDebug(rapporLog, "Bloom filter calculation failed");
+      return false;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      Bits prr;
+      if (!_EncodeBitsInternal(blooms[i], &prr, &irr_out[start + i])) {
+        return false;
+      }
+      if (bloom_out) {
+        bloom_out[start + i] = blooms[i];
+      }
+      if (prr_out) {
+        prr_out[start + i] = prr;
+      }
+    }
+  }
+  return true;
+}
+
+bool Encoder::_EncodeStringsInternal(const std::string* values, size_t count,
+                                     Bits* bloom_out, Bits* prr_out,
+                                     Bits* irr_out) const {
+  return EncodeStringsImpl(values, count, bloom_out, prr_out, irr_out);
+}
+
+bool Encoder::_EncodeStringsInternal(const std::string_view* values,
+                                     size_t count, Bits* bloom_out,
+                                     Bits* prr_out, Bits* irr_out) const {
+  return EncodeStringsImpl(values, count, bloom_out, prr_out, irr_out);
+}
+
+bool Encoder::_EncodeBitsBatchInternal(const Bits* bits, size_t count,
+                                       Bits* prr_out, Bits* irr_out) const {
+  for (size_t i = 0; i < count; ++i) {
+    Bits prr;
+    if (!_EncodeBitsInternal(bits[i], &prr, &irr_out[i])) {
+      return false;
+    }
+    if (prr_out) {
+      prr_out[i] = prr;
+    }
+  }
+  return true;
+}
+
+bool Encoder::EncodeStringFanOut(std::string_view value,
+                                 const Encoder* const* encoders, size_t count,
+                                 Bits* irr_out) {
+  // Bloom filters computed so far.  Fan-out lists usually have a single
+  // shape; past kMaxShapes, later shapes are simply recomputed.
+  static const int kMaxShapes = 4;
+  BloomShape shapes[kMaxShapes];
+  Bits blooms[kMaxShapes];
+  int num_shapes = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    const Encoder* encoder = encoders[i];
+    const BloomShape shape = encoder->bloom_shape();
+
+    int found = -1;
+    for (int j = 0; j < num_shapes; ++j) {
+      if (shapes[j] == shape) {
+        found = j;
+        break;
+      }
+    }
+
+    Bits bloom;
+    if (found >= 0) {
+      bloom = blooms[found];
+    } else {
+      if (!encoder->MakeBloomFilter(value, &bloom)) {
+        qCDebug(rapporLog, "Bloom filter calculation failed");
+        return false;
+      }
+      if (num_shapes < kMaxShapes) {
+        shapes[num_shapes] = shape;
+        blooms[num_shapes] = bloom;
+        ++num_shapes;
+      }
+    }
+
+    Bits prr;
+    if (!encoder->_EncodeBitsInternal(bloom, &prr, &irr_out[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Encoder::EncodeStrings(const std::string* values, size_t count,
+                            Bits* irr_out) const {
+  return _EncodeStringsInternal(values, count, nullptr, nullptr, irr_out);
+}
+
+bool Encoder::EncodeStrings(const std::string_view* values, size_t count,
+                            Bits* irr_out) const {
+  return _EncodeStringsInternal(values, count, nullptr, nullptr, irr_out);
+}
+
+bool Encoder::EncodeBitsBatch(const Bits* bits, size_t count,
+                              Bits* irr_out) const {
+  return _EncodeBitsBatchInternal(bits, count, nullptr, irr_out);
 }
 
-bool Encoder::EncodeString(const std::string& value,
-                           std::vector<uint8_t>* irr_out) const try {
-  std::vector<uint8_t> bloom_out;
-  std::vector<uint8_t> hmac_out;
-  std::vector<uint8_t> uniform;
-  std::vector<uint8_t> f_mask;
+// Write a Bloom filter into a wide report, used for num_bits > 32.
+template <int N>
+bool Encoder::MakeBloomFilter(std::string_view value,
+                              BasicBits<N>* bloom_out) const {
+  // Generate the hash.
+  uint8_t hash_output[kMaxBloomHashBytes];
+  size_t hash_size;
+  if (!BloomHash(value, hash_output, &hash_size)) {
+    qCDebug(rapporLog, "Hash function failed");
+    return false;
+  }
+  return BloomFromHash(hash_output, hash_size, bloom_out);
+}
+
+template <int N>
+bool Encoder::BloomFromHash(const uint8_t* hash_output, size_t hash_size,
+                            BasicBits<N>* bloom_out) const {
   const int num_bits = params_.num_bits_;
+  const int num_hashes = params_.num_hashes_;
 
-  uniform.resize(num_bits / 8, 0);
-  f_mask.resize(num_bits / 8, 0);
-  irr_out->resize(num_bits / 8, 0);
+  BasicBits<N> bloom;
 
-  // Set bloom_out.
-  if (!MakeBloomFilter(value, &bloom_out)) {
-    qCDebug(rapporLog, "Bloom filter calculation failed");
+  // Check that we have enough bytes of hash available.
+  int exponent = 0;
+  int bytes_needed = 0;
+  while ((1 << exponent) < num_bits) {
+    exponent++;
+  }
+  bytes_needed = ((exponent - 1) / 8) + 1;
+  if (bytes_needed > 4) {
+    qCDebug(rapporLog, "Can only use 4 bytes of hash at a time, needed %d "
+        "to address %d bits.", bytes_needed, num_bits);
+    return false;
+  }
+  if (hash_size < static_cast<size_t>(bytes_needed * num_hashes)) {
+    qCDebug(rapporLog, "Hash function returned %zu bytes, but we needed "
+        "%d bytes * %d hashes. Choose lower num_hashes or "
+        "a different hash function.",
+        hash_size, bytes_needed, num_hashes);
     return false;
   }
 
-  // Set hmac_out.
-  hmac_out.resize(num_bits);  // Signal to HmacDrbg about desired output size.
-  // Call HmacDrbg
-  std::string hmac_value =  kHmacPrrPrefix + encoder_id_;
-  for (size_t i = 0; i < bloom_out.size(); ++i) {
-    hmac_value.append(reinterpret_cast<char *>(&bloom_out[i]), 1);
+  // To determine which bit to set in the Bloom filter, use 1 or more
+  // bytes of the MD5.
+  int hash_byte = 0;
+  for (int i = 0; i < num_hashes; ++i) {
+    int bit_to_set = 0;
+    for (int j = 0; j < bytes_needed; ++j) {
+      bit_to_set |= hash_output[hash_byte] << (j * 8);
+      ++hash_byte;
+    }
+    bit_to_set %= num_bits;
+    bloom.set(bit_to_set);
   }
-  deps_.hmac_func_(deps_.client_secret_, hmac_value, &hmac_out);
-  if (static_cast<int>(hmac_out.size()) != num_bits) {
-    qCDebug(rapporLog, "Needed %d bytes from Hmac function, received %zu bytes.",
-        num_bits, hmac_out.size());
+
+  *bloom_out = bloom;
+  return true;
+}
+
+template <int N>
+bool Encoder::GetPrrMasks(const BasicBits<N>& bits, BasicBits<N>* uniform_out,
+                          BasicBits<N>* f_mask_out) const {
+  const int num_bits = params_.num_bits_;
+  const int num_bytes = num_bits / 8;
+
+  // HMAC over the big-endian bytes of the input, so that reports match the
+  // byte-vector API.
+  uint8_t bits_bytes[BasicBits<N>::kNumBytes];
+  bits.ToBytes(bits_bytes, num_bytes);
+
+  std::string& hmac_value = GetScratch().hmac_input;
+  hmac_value.assign(kHmacPrrPrefix);
+  hmac_value.append(encoder_id_);
+  hmac_value.append(reinterpret_cast<char*>(bits_bytes), num_bytes);
+
+  uint8_t hmac_out[N];
+  if (!PrrHmac(hmac_value, hmac_out, num_bits)) {
     return false;
   }
 
@@ -342,32 +770,62 @@ bool Encoder::EncodeString(const std::string& value,
   // number for the f_mask.
   uint8_t threshold128 = static_cast<uint8_t>(params_.prob_f_ * 128);
 
-  // Construct uniform and f_mask bitwise.
-  for (int i = 0; i < num_bits; i++) {
-    uint8_t byte = hmac_out[i];
-    uint8_t u_bit = byte & 0x01;  // 1 bit of entropy.
-    int vector_index = (num_bits - 1 - i) / 8;
-    uint8_t rand128 = byte >> 1;  // 7 bits of entropy.
-    uint8_t noise_bit = (rand128 < threshold128);
-    uniform[vector_index] |= (u_bit << (i % 8));
-    f_mask[vector_index] |= (noise_bit << (i % 8));
-  }
-
-  for (size_t i = 0; i < bloom_out.size(); i++) {
-    Bits p_bits = 0;
-    Bits q_bits = 0;
-    uint8_t prr = 0;
-    prr = (bloom_out[i] & ~f_mask[i]) | (uniform[i] & f_mask[i]);
-    // GetMask operates on Uint32, so we generate a new p_bits every 4
-    // bytes, and use each of its bytes once.
-    if (i % 4 == 0) {
-      // Need new p_bits, q_bits values to work with.
-      deps_.irr_rand_->GetMask(params_.prob_p_, 32, &p_bits);
-      deps_.irr_rand_->GetMask(params_.prob_q_, 32, &q_bits);
-    }
-    (*irr_out)[i] = (shifted(p_bits, i) & ~prr)
-        | (shifted(q_bits, i) & prr);
+  BasicBits<N> uniform;
+  BasicBits<N> f_mask;
+  ExtractPrrMasks(hmac_out, num_bits, threshold128, &uniform.lane(0),
+                  &f_mask.lane(0));
+
+  *uniform_out = uniform;
+  *f_mask_out = f_mask;
+  return true;
+}
+
+template <int N>
+void Encoder::GetIrrMasks(BasicBits<N>* p_out, BasicBits<N>* q_out) const {
+  const int num_bits = params_.num_bits_;
+
+  Bits p_words[kMaxWideBits / 32];
+  Bits q_words[kMaxWideBits / 32];
+  deps_->irr_rand_->GetMasks(params_.prob_p_, params_.prob_q_, num_bits,
+                            p_words, q_words);
+
+  BasicBits<N> p_bits;
+  BasicBits<N> q_bits;
+  for (int i = 0; i < (num_bits + 31) / 32; i++) {
+    int shift = (i % 2) * 32;
+    p_bits.lane(i / 2) |= static_cast<uint64_t>(p_words[i]) << shift;
+    q_bits.lane(i / 2) |= static_cast<uint64_t>(q_words[i]) << shift;
+  }
+
+  *p_out = p_bits;
+  *q_out = q_bits;
+}
+
+template <int N>
+bool Encoder::_EncodeBitsInternal(const BasicBits<N>& bits,
+                                  BasicBits<N>* prr_out,
+                                  BasicBits<N>* irr_out) const try {
+  if (params_.num_bits_ > N) {
+    qCDebug(rapporLog, "num_bits (%d) doesn't fit in a %d-bit report",
+        params_.num_bits_, N);
+    return false;
+  }
+
+  // Compute Permanent Randomized Response (PRR).
+  BasicBits<N> uniform;
+  BasicBits<N> f_mask;
+  if (!GetPrrMasks(bits, &uniform, &f_mask)) {
+    qCDebug(rapporLog, "GetPrrMasks failed");
+    return false;
   }
+  BasicBits<N> prr = Select(bits, uniform, f_mask);
+  *prr_out = prr;
+
+  // Compute Instantaneous Randomized Response (IRR).
+  BasicBits<N> p_bits;
+  BasicBits<N> q_bits;
+  GetIrrMasks(&p_bits, &q_bits);
+  *irr_out = Select(p_bits, q_bits, prr);
 
   return true;
 } catch (const std::exception &e) { // from GetMask -> std::random
@@ -375,9 +833,101 @@ bool Encoder::EncodeString(const std::string& value,
   return false;
 }
 
+template <int N>
+bool Encoder::_EncodeStringInternal(std::string_view value,
+                                    BasicBits<N>* bloom_out,
+                                    BasicBits<N>* prr_out,
+                                    BasicBits<N>* irr_out) const {
+  if (params_.num_bits_ > N) {
+    qCDebug(rapporLog, "num_bits (%d) doesn't fit in a %d-bit report",
+        params_.num_bits_, N);
+    return false;
+  }
+  if (!MakeBloomFilter(value, bloom_out)) {
+    qCDebug(rapporLog, "Bloom filter calculation failed");
+    return false;
+  }
+  return _EncodeBitsInternal(*bloom_out, prr_out, irr_out);
+}
+
+template <int N>
+bool Encoder::EncodeBits(const BasicBits<N>& bits,
+                         BasicBits<N>* irr_out) const {
+  BasicBits<N> unused_prr;
+  return _EncodeBitsInternal(bits, &unused_prr, irr_out);
+}
+
+template <int N>
+bool Encoder::EncodeString(std::string_view value,
+                           BasicBits<N>* irr_out) const {
+  BasicBits<N> unused_bloom;
+  BasicBits<N> unused_prr;
+  return _EncodeStringInternal(value, &unused_bloom, &unused_prr, irr_out);
+}
+
+#define RAPPOR_INSTANTIATE_WIDE_ENCODER(N)                                  \
+  template QT_RAPPOR_EXPORT bool Encoder::EncodeBits(                       \
+      const BasicBits<N>&, BasicBits<N>*) const;                            \
+  template QT_RAPPOR_EXPORT bool Encoder::EncodeString(                     \
+      std::string_view, BasicBits<N>*) const;                               \
+  template QT_RAPPOR_EXPORT bool Encoder::_EncodeBitsInternal(              \
+      const BasicBits<N>&, BasicBits<N>*, BasicBits<N>*) const;             \
+  template QT_RAPPOR_EXPORT bool Encoder::_EncodeStringInternal(            \
+      std::string_view, BasicBits<N>*, BasicBits<N>*, BasicBits<N>*) const; \
+  template bool Encoder::BloomFromHash(const uint8_t*, size_t,              \
+                                       BasicBits<N>*) const;
+
+RAPPOR_INSTANTIATE_WIDE_ENCODER(64)
+RAPPOR_INSTANTIATE_WIDE_ENCODER(128)
+RAPPOR_INSTANTIATE_WIDE_ENCODER(256)
+RAPPOR_INSTANTIATE_WIDE_ENCODER(512)
+RAPPOR_INSTANTIATE_WIDE_ENCODER(1024)
+
+#undef RAPPOR_INSTANTIATE_WIDE_ENCODER
+
+template <int N>
+static bool EncodeStringToBytes(const Encoder& encoder, std::string_view value,
+                                int num_bits, std::vector<uint8_t>* irr_out) {
+  BasicBits<N> irr;
+  if (!encoder.EncodeString(value, &irr)) {
+    return false;
+  }
+  irr_out->resize(num_bits / 8);
+  irr.ToBytes(irr_out->data(), num_bits / 8);
+  return true;
+}
+
+bool Encoder::EncodeString(std::string_view value,
+                           std::vector<uint8_t>* irr_out) const {
+  const int num_bits = params_.num_bits_;
+  if (num_bits <= 64) {
+    return EncodeStringToBytes<64>(*this, value, num_bits, irr_out);
+  } else if (num_bits <= 128) {
+    return EncodeStringToBytes<128>(*this, value, num_bits, irr_out);
+  } else if (num_bits <= 256) {
+    return EncodeStringToBytes<256>(*this, value, num_bits, irr_out);
+  } else if (num_bits <= 512) {
+    return EncodeStringToBytes<512>(*this, value, num_bits, irr_out);
+  } else {
+    return EncodeStringToBytes<kMaxWideBits>(*this, value, num_bits, irr_out);
+  }
+}
+
 void Encoder::set_cohort(uint32_t cohort) {
   cohort_ = cohort;
   cohort_str_ = ToBigEndian(cohort_);
 }
 
+void Encoder::set_prr_cache_size(size_t max_entries) {
+  if (max_entries == 0) {
+    prr_cache_.reset();
+  } else {
+    prr_cache_ = std::make_shared<PrrCache>(params_.num_bits_, max_entries);
+  }
+}
+
+void Encoder::set_bloom_cache(std::shared_ptr<BloomCache> cache) {
+  bloom_cache_ = std::move(cache);
+}
+
 }  // namespace rappor
@@ -0,0 +1,164 @@
+// Rough throughput numbers for the encoder variants.
+//
+// Usage: encoder_bench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "qt-rappor-client/chacha_rand_impl.h"
+#include "qt-rappor-client/encoder.h"
+#include "qt-rappor-client/enum_encoder.h"
+#include "qt-rappor-client/kernel_rand_impl.h"
+#include "qt-rappor-client/philox_rand_impl.h"
+#include "qt-rappor-client/qt_hash_impl.h"
+#include "qt-rappor-client/static_encoder.h"
+#include "qt-rappor-client/std_rand_impl.h"
+
+namespace {
+
+struct BenchParams {
+  static constexpr int num_bits = 32;
+  static constexpr int num_hashes = 2;
+  static constexpr int num_cohorts = 128;
+  static constexpr float prob_f = 0.25f;
+  static constexpr float prob_p = 0.75f;
+  static constexpr float prob_q = 0.5f;
+};
+
+// Runs fn(i) for i in [0, iterations) and prints the time per call.
+void Run(const char* name, int iterations, const std::function<bool(int)>& fn) {
+  auto start = std::chrono::steady_clock::now();
+  bool ok = true;
+  for (int i = 0; i < iterations; ++i) {
+    ok = fn(i) && ok;
+  }
+  auto end = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+  printf("%-32s %8.1f ns/call%s\n", name, ns / iterations,
+         ok ? "" : " (ERRORS)");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+
+  rappor::Deps deps(rappor::Md5, "client-secret", rappor::HmacSha256,
+                    std::make_shared<rappor::StdRand>());
+  rappor::Params params(BenchParams::num_bits, BenchParams::num_hashes,
+                        BenchParams::num_cohorts, BenchParams::prob_f,
+                        BenchParams::prob_p, BenchParams::prob_q);
+  rappor::Encoder encoder("metric-name", params, deps);
+  rappor::StaticEncoder<BenchParams> static_encoder("metric-name", deps);
+
+  std::vector<std::string> values;
+  for (int i = 0; i < 1000; ++i) {
+    values.push_back("value-" + std::to_string(i));
+  }
+  const size_t n = values.size();
+  rappor::Bits out;
+
+  Run("Encoder::EncodeString", iterations, [&](int i) {
+    return encoder.EncodeString(values[i % n], &out);
+  });
+  Run("StaticEncoder::EncodeString", iterations, [&](int i) {
+    return static_encoder.EncodeString(values[i % n], &out);
+  });
+
+  // Batches of 16: Bloom hashes go through Md5Batch().
+  rappor::Bits batch_out[16];
+  Run("Encoder::EncodeStrings x16", iterations / 16, [&](int i) {
+    return encoder.EncodeStrings(&values[(16 * i) % (n - 16)], 16, batch_out);
+  });
+
+  // The same value reported under four metrics.
+  rappor::Encoder metric_b("metric-b", params, deps);
+  rappor::Encoder metric_c("metric-c", params, deps);
+  rappor::Encoder metric_d("metric-d", params, deps);
+  const rappor::Encoder* metrics[] = { &encoder, &metric_b, &metric_c,
+                                       &metric_d };
+  rappor::Bits fan_out[4];
+  Run("4x Encoder::EncodeString", iterations / 4, [&](int i) {
+    bool ok = true;
+    for (int m = 0; m < 4; ++m) {
+      ok = metrics[m]->EncodeString(values[i % n], &fan_out[m]) && ok;
+    }
+    return ok;
+  });
+  Run("Encoder::EncodeStringFanOut x4", iterations / 4, [&](int i) {
+    return rappor::Encoder::EncodeStringFanOut(values[i % n], metrics, 4,
+                                               fan_out);
+  });
+
+  std::vector<std::string> domain(values.begin(), values.begin() + 16);
+  rappor::EnumEncoder enum_encoder(&encoder, domain);
+  Run("EnumEncoder::EncodeIndex", iterations, [&](int i) {
+    return enum_encoder.EncodeIndex(i % domain.size(), &out);
+  });
+
+  Run("Encoder::EncodeBits", iterations, [&](int i) {
+    return encoder.EncodeBits(i, &out);
+  });
+  Run("StaticEncoder::EncodeBits", iterations, [&](int i) {
+    return static_encoder.EncodeBits(i, &out);
+  });
+
+  // PRR-sized HMACs: 16 short messages under one key, one at a time and
+  // through the multi-buffer kernel.
+  std::vector<std::string_view> hmac_keys(16, "client-secret");
+  std::vector<std::string_view> hmac_values(values.begin(), values.begin() + 16);
+  std::vector<rappor::HmacDigest> digests(16);
+  Run("16x HmacSha256Into", iterations / 16, [&](int) {
+    bool ok = true;
+    for (size_t k = 0; k < 16; ++k) {
+      ok = rappor::HmacSha256Into(hmac_keys[k], hmac_values[k], &digests[k]) && ok;
+    }
+    return ok;
+  });
+  Run("HmacSha256Batch x16", iterations / 16, [&](int) {
+    return rappor::HmacSha256Batch(hmac_keys.data(), hmac_values.data(), 16,
+                                   digests.data());
+  });
+
+  // Bloom-sized MD5s, one at a time and through the multi-buffer kernel.
+  std::vector<rappor::HashDigest> md5_digests(16);
+  Run("16x Md5Into", iterations / 16, [&](int) {
+    bool ok = true;
+    for (size_t k = 0; k < 16; ++k) {
+      ok = rappor::Md5Into(hmac_values[k], &md5_digests[k]) && ok;
+    }
+    return ok;
+  });
+  Run("Md5Batch x16", iterations / 16, [&](int) {
+    return rappor::Md5Batch(hmac_values.data(), 16, md5_digests.data());
+  });
+
+  // IRR randomness alone: p and q masks for a 64-bit report.
+  rappor::StdRand std_rand;
+  rappor::ChaChaRand chacha_rand;
+  rappor::KernelRand kernel_rand;
+  rappor::PhiloxRand philox_rand(1, 2, 3);
+  rappor::Bits p[2];
+  rappor::Bits q[2];
+  Run("StdRand::GetMasks (64 bits)", iterations, [&](int) {
+    std_rand.GetMasks(BenchParams::prob_p, BenchParams::prob_q, 64, p, q);
+    return true;
+  });
+  Run("ChaChaRand::GetMasks (64 bits)", iterations, [&](int) {
+    chacha_rand.GetMasks(BenchParams::prob_p, BenchParams::prob_q, 64, p, q);
+    return true;
+  });
+  Run("KernelRand::GetMasks (64 bits)", iterations, [&](int) {
+    kernel_rand.GetMasks(BenchParams::prob_p, BenchParams::prob_q, 64, p, q);
+    return true;
+  });
+  Run("PhiloxRand::GetMasks (64 bits)", iterations, [&](int) {
+    philox_rand.GetMasks(BenchParams::prob_p, BenchParams::prob_q, 64, p, q);
+    return true;
+  });
+}
@@ -0,0 +1,114 @@
+#include "qt-rappor-client/encoder_registry.h"
+
+#include <string.h>
+
+namespace rappor {
+
+// Metric names are packed into blocks of this size; longer names get a block
+// of their own.
+static const size_t kNameBlockSize = 4096;
+
+EncoderRegistry::Entry::Entry(std::string_view id, const Params& params)
+    : id(id), params(params), encoder(nullptr) {
+}
+
+EncoderRegistry::Entry::Entry(Entry&& other) noexcept
+    : id(other.id),
+      params(other.params),
+      encoder(other.encoder.exchange(nullptr)) {
+}
+
+EncoderRegistry::Entry::~Entry() {
+  delete encoder.load();
+}
+
+EncoderRegistry::EncoderRegistry(const Deps& deps)
+    : deps_(deps),
+      cohort_hash_(Encoder::CohortHash(deps)),
+      keyed_hmac_(deps.client_secret_),
+      name_block_used_(kNameBlockSize) {
+}
+
+EncoderRegistry::~EncoderRegistry() {
+}
+
+std::string_view EncoderRegistry::Intern(std::string_view name) {
+  if (name.empty()) {
+    return std::string_view();
+  }
+  if (name.size() > kNameBlockSize) {
+    // Insert before the current block, which keeps filling up.
+    auto it = name_blocks_.insert(
+        name_blocks_.empty() ? name_blocks_.end() : name_blocks_.end() - 1,
+        std::unique_ptr<char[]>(new char[name.size()]));
+    memcpy(it->get(), name.data(), name.size());
+    return std::string_view(it->get(), name.size());
+  }
+  if (name_block_used_ + name.size() > kNameBlockSize) {
+    name_blocks_.emplace_back(new char[kNameBlockSize]);
+    name_block_used_ = 0;
+  }
+  char* dest = name_blocks_.back().get() + name_block_used_;
+  memcpy(dest, name.data(), name.size());
+  name_block_used_ += name.size();
+  return std::string_view(dest, name.size());
+}
+
+int EncoderRegistry::Register(std::string_view encoder_id,
+                              const Params& params) {
+  int handle = Find(encoder_id);
+  if (handle >= 0) {
+    return handle;
+  }
+
+  // Fail here rather than on whichever thread first encodes the metric.
+  Encoder::CheckParams(params, deps_);
+
+  handle = static_cast<int>(entries_.size());
+  std::string_view id = Intern(encoder_id);
+  entries_.emplace_back(id, params);
+  index_.emplace(id, handle);
+  return handle;
+}
+
+int EncoderRegistry::Find(std::string_view encoder_id) const {
+  auto it = index_.find(encoder_id);
+  return it == index_.end() ? -1 : it->second;
+}
+
+const Encoder* EncoderRegistry::Get(int handle) const {
+  if (handle < 0 || static_cast<size_t>(handle) >= entries_.size()) {
+    return nullptr;
+  }
+  const Entry& entry = entries_[handle];
+
+  Encoder* encoder = entry.encoder.load(std::memory_order_acquire);
+  if (encoder) {
+    return encoder;
+  }
+
+  // Build outside any lock.  If another thread wins the race, its encoder is
+  // identical; drop ours.
+  Encoder* built = new Encoder(entry.id, entry.params, deps_, cohort_hash_,
+                               &keyed_hmac_);
+  if (entry.encoder.compare_exchange_strong(encoder, built,
+                                            std::memory_order_acq_rel)) {
+    return built;
+  }
+  delete built;
+  return encoder;
+}
+
+const Encoder* EncoderRegistry::Get(std::string_view encoder_id) const {
+  return Get(Find(encoder_id));
+}
+
+size_t EncoderRegistry::built() const {
+  size_t count = 0;
+  for (const Entry& entry : entries_) {
+    count += entry.encoder.load(std::memory_order_relaxed) ? 1 : 0;
+  }
+  return count;
+}
+
+}  // namespace rappor
@@ -0,0 +1,113 @@
+#include "qt-rappor-client/enum_encoder.h"
+
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(rapporLog)
+
+namespace rappor {
+
+EnumEncoder::EnumEncoder(const Encoder* encoder,
+                         const std::vector<std::string>& domain, Mode mode)
+    : encoder_(encoder), domain_(domain) {
+  const int num_bits = encoder_->params_.num_bits();
+  if (num_bits > 32) {
+    qFatal("EnumEncoder needs num_bits <= 32, got %d", num_bits);
+  }
+  if (mode == kOneHot && domain.size() > static_cast<size_t>(num_bits)) {
+    qFatal("One-hot domain of %zu values doesn't fit in %d bits",
+           domain.size(), num_bits);
+  }
+
+  BuildIndex();
+
+  bloom_.reserve(domain.size());
+  prr_.reserve(domain.size());
+  for (size_t i = 0; i < domain.size(); ++i) {
+    Bits bloom;
+    if (mode == kOneHot) {
+      bloom = Bits(1) << i;
+    } else if (!encoder_->MakeBloomFilter(domain[i], &bloom)) {
+      qFatal("Bloom filter calculation failed");
+    }
+
+    Bits uniform;
+    Bits f_mask;
+    if (!encoder_->GetPrrMasks(bloom, &uniform, &f_mask)) {
+      qFatal("GetPrrMasks failed");
+    }
+    bloom_.push_back(bloom);
+    prr_.push_back((bloom & ~f_mask) | (uniform & f_mask));
+  }
+}
+
+EnumEncoder::EnumEncoder(const EnumEncoder& other)
+    : encoder_(other.encoder_),
+      bloom_(other.bloom_),
+      prr_(other.prr_),
+      domain_(other.domain_) {
+  BuildIndex();
+}
+
+EnumEncoder& EnumEncoder::operator=(const EnumEncoder& other) {
+  if (this != &other) {
+    encoder_ = other.encoder_;
+    bloom_ = other.bloom_;
+    prr_ = other.prr_;
+    domain_ = other.domain_;
+    BuildIndex();
+  }
+  return *this;
+}
+
+void EnumEncoder::BuildIndex() {
+  index_.clear();
+  index_.reserve(domain_.size());
+  for (size_t i = 0; i < domain_.size(); ++i) {
+    if (!index_.emplace(domain_[i], static_cast<int>(i)).second) {
+      qFatal("Duplicate enum value '%s'", domain_[i].c_str());
+    }
+  }
+}
+
+int EnumEncoder::IndexOf(std::string_view value) const {
+  auto it = index_.find(value);
+  return it == index_.end() ? -1 : it->second;
+}
+
+bool EnumEncoder::_EncodeIndexInternal(size_t index, Bits* bloom_out,
+                                       Bits* prr_out, Bits* irr_out) const try {
+  if (index >= prr_.size()) {
+    qCDebug(rapporLog, "Enum index %zu out of range", index);
+    return false;
+  }
+  const Bits prr = prr_[index];
+
+  Bits p_bits;
+  Bits q_bits;
+  encoder_->GetIrrMasks(&p_bits, &q_bits);
+
+  *bloom_out = bloom_[index];
+  *prr_out = prr;
+  *irr_out = (p_bits & ~prr) | (q_bits & prr);
+  return true;
+} catch (const std::exception &e) { // from GetMask -> std::random
+  qCWarning(rapporLog) << "Exception while encoding enum" << e.what();
+  return false;
+}
+
+bool EnumEncoder::EncodeIndex(size_t index, Bits* irr_out) const {
+  Bits unused_bloom;
+  Bits unused_prr;
+  return _EncodeIndexInternal(index, &unused_bloom, &unused_prr, irr_out);
+}
+
+bool EnumEncoder::EncodeString(std::string_view value, Bits* irr_out) const {
+  int index = IndexOf(value);
+  if (index < 0) {
+    qCDebug(rapporLog, "Value is not in the enum domain");
+    return false;
+  }
+  return EncodeIndex(index, irr_out);
+}
+
+}  // namespace rappor
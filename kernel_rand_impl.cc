@@ -0,0 +1,87 @@
+#include "qt-rappor-client/kernel_rand_impl.h"
+
+#include "qt-rappor-client/bitsliced_mask.h"
+#include "qt-rappor-client/os_random.h"
+
+#include <memory>
+
+namespace rappor {
+
+namespace {
+
+class ThreadBuffer
+{
+public:
+    static const size_t kWords = KernelRand::kBufferBytes / sizeof(Bits);
+
+    ThreadBuffer()
+        : m_words(new Bits[kWords])
+    {
+    }
+
+    // Called once per GetMask(s) call, before any NextWord().
+    void CheckFork()
+    {
+        uint32_t generation = ForkGeneration();
+        if (generation != m_forkGeneration) {
+            m_forkGeneration = generation;
+            m_next = kWords;
+        }
+    }
+
+    Bits NextWord()
+    {
+        if (m_next == kWords) {
+            if (KernelRandom(reinterpret_cast<uint8_t*>(m_words.get()),
+                             kWords * sizeof(Bits)) > 0) {
+                qFatal("KernelRand: no randomness available from the kernel");
+            }
+            m_next = 0;
+        }
+        return m_words[m_next++];
+    }
+
+    Bits BitslicedMask(uint32_t threshold)
+    {
+        return rappor::BitslicedMask(threshold, [this] { return NextWord(); });
+    }
+
+private:
+    std::unique_ptr<Bits[]> m_words;
+    size_t m_next = kWords;
+    uint32_t m_forkGeneration = 0;
+};
+
+ThreadBuffer& LocalBuffer()
+{
+    thread_local ThreadBuffer buffer;
+    buffer.CheckFork();
+    return buffer;
+}
+
+}  // namespace
+
+KernelRand::KernelRand()
+{
+    RegisterForkHandler();
+}
+
+void KernelRand::GetMask(float prob, int num_bits, Bits* mask_out) const
+{
+    *mask_out = LocalBuffer().BitslicedMask(Threshold128(prob)) & LowBits(num_bits);
+}
+
+void KernelRand::GetMasks(float prob_p, float prob_q, int num_bits,
+                          Bits* p_out, Bits* q_out) const
+{
+    const uint32_t p_threshold = Threshold128(prob_p);
+    const uint32_t q_threshold = Threshold128(prob_q);
+
+    ThreadBuffer& buffer = LocalBuffer();
+    for (int i = 0; num_bits > 0; ++i, num_bits -= 32) {
+        p_out[i] = buffer.BitslicedMask(p_threshold) & LowBits(num_bits);
+        q_out[i] = buffer.BitslicedMask(q_threshold) & LowBits(num_bits);
+    }
+}
+
+}  // namespace rappor
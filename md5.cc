@@ -0,0 +1,428 @@
+#include "qt-rappor-client/md5.h"
+
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define RAPPOR_MD5_X86 1
+#include <immintrin.h>
+#endif
+
+namespace rappor {
+
+const uint32_t kMd5InitialState[4] = {
+  0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476
+};
+
+namespace {
+
+// floor(abs(sin(i + 1)) * 2^32)
+const uint32_t kSineTable[64] = {
+  0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+  0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+  0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+  0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+  0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+  0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+  0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+  0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+  0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+  0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+  0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+  0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+  0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+  0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+  0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+  0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+inline uint32_t Rotl(uint32_t x, int n) {
+  return (x << n) | (x >> (32 - n));
+}
+
+inline uint32_t LoadLittleEndian32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) |
+         (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline void StoreLittleEndian32(uint32_t v, uint8_t* p) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+// One step: a = b + ((a + f(b, c, d) + m + t) <<< s).  F and G are written
+// with one fewer operation than in RFC 1321.
+#define RAPPOR_MD5_STEP(f, a, b, c, d, m, t, s) \
+  a += f(b, c, d) + (m) + (t);                  \
+  a = Rotl(a, s) + b;
+
+#define RAPPOR_MD5_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define RAPPOR_MD5_G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+#define RAPPOR_MD5_H(x, y, z) ((x) ^ (y) ^ (z))
+#define RAPPOR_MD5_I(x, y, z) ((y) ^ ((x) | ~(z)))
+
+// Process one 64-byte block, fully unrolled.
+void Compress(uint32_t state[4], const uint8_t* block) {
+  uint32_t m[16];
+  for (int i = 0; i < 16; ++i) {
+    m[i] = LoadLittleEndian32(block + 4 * i);
+  }
+
+  uint32_t a = state[0];
+  uint32_t b = state[1];
+  uint32_t c = state[2];
+  uint32_t d = state[3];
+  const uint32_t* t = kSineTable;
+
+  RAPPOR_MD5_STEP(RAPPOR_MD5_F, a, b, c, d, m[0], t[0], 7)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_F, d, a, b, c, m[1], t[1], 12)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_F, c, d, a, b, m[2], t[2], 17)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_F, b, c, d, a, m[3], t[3], 22)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_F, a, b, c, d, m[4], t[4], 7)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_F, d, a, b, c, m[5], t[5], 12)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_F, c, d, a, b, m[6], t[6], 17)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_F, b, c, d, a, m[7], t[7], 22)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_F, a, b, c, d, m[8], t[8], 7)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_F, d, a, b, c, m[9], t[9], 12)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_F, c, d, a, b, m[10], t[10], 17)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_F, b, c, d, a, m[11], t[11], 22)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_F, a, b, c, d, m[12], t[12], 7)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_F, d, a, b, c, m[13], t[13], 12)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_F, c, d, a, b, m[14], t[14], 17)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_F, b, c, d, a, m[15], t[15], 22)
+
+  RAPPOR_MD5_STEP(RAPPOR_MD5_G, a, b, c, d, m[1], t[16], 5)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_G, d, a, b, c, m[6], t[17], 9)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_G, c, d, a, b, m[11], t[18], 14)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_G, b, c, d, a, m[0], t[19], 20)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_G, a, b, c, d, m[5], t[20], 5)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_G, d, a, b, c, m[10], t[21], 9)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_G, c, d, a, b, m[15], t[22], 14)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_G, b, c, d, a, m[4], t[23], 20)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_G, a, b, c, d, m[9], t[24], 5)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_G, d, a, b, c, m[14], t[25], 9)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_G, c, d, a, b, m[3], t[26], 14)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_G, b, c, d, a, m[8], t[27], 20)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_G, a, b, c, d, m[13], t[28], 5)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_G, d, a, b, c, m[2], t[29], 9)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_G, c, d, a, b, m[7], t[30], 14)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_G, b, c, d, a, m[12], t[31], 20)
+
+  RAPPOR_MD5_STEP(RAPPOR_MD5_H, a, b, c, d, m[5], t[32], 4)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_H, d, a, b, c, m[8], t[33], 11)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_H, c, d, a, b, m[11], t[34], 16)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_H, b, c, d, a, m[14], t[35], 23)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_H, a, b, c, d, m[1], t[36], 4)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_H, d, a, b, c, m[4], t[37], 11)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_H, c, d, a, b, m[7], t[38], 16)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_H, b, c, d, a, m[10], t[39], 23)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_H, a, b, c, d, m[13], t[40], 4)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_H, d, a, b, c, m[0], t[41], 11)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_H, c, d, a, b, m[3], t[42], 16)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_H, b, c, d, a, m[6], t[43], 23)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_H, a, b, c, d, m[9], t[44], 4)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_H, d, a, b, c, m[12], t[45], 11)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_H, c, d, a, b, m[15], t[46], 16)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_H, b, c, d, a, m[2], t[47], 23)
+
+  RAPPOR_MD5_STEP(RAPPOR_MD5_I, a, b, c, d, m[0], t[48], 6)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_I, d, a, b, c, m[7], t[49], 10)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_I, c, d, a, b, m[14], t[50], 15)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_I, b, c, d, a, m[5], t[51], 21)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_I, a, b, c, d, m[12], t[52], 6)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_I, d, a, b, c, m[3], t[53], 10)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_I, c, d, a, b, m[10], t[54], 15)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_I, b, c, d, a, m[1], t[55], 21)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_I, a, b, c, d, m[8], t[56], 6)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_I, d, a, b, c, m[15], t[57], 10)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_I, c, d, a, b, m[6], t[58], 15)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_I, b, c, d, a, m[13], t[59], 21)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_I, a, b, c, d, m[4], t[60], 6)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_I, d, a, b, c, m[11], t[61], 10)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_I, c, d, a, b, m[2], t[62], 15)
+  RAPPOR_MD5_STEP(RAPPOR_MD5_I, b, c, d, a, m[9], t[63], 21)
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+}
+
+#ifdef RAPPOR_MD5_X86
+
+// Multi-buffer kernels: lane l of each vector belongs to message l, so the
+// 64 steps run on 4 (SSE2), 8 (AVX2) or 16 (AVX-512) independent blocks at
+// once.  The step order and round functions are those of Compress(); the
+// per-ISA macros below supply the vector operations.
+#define RAPPOR_MD5_VSTEP(f, a, b, c, d, i, k, s)                      \
+  a = ADD(ADD(a, f(b, c, d)), ADD(w[i], SET1(kSineTable[k])));         \
+  a = ADD(ROTL(a, s), b);
+
+#define RAPPOR_MD5_LANES_BODY(kLanes)                                        \
+  alignas(64) uint32_t words[16][kLanes];                                    \
+  for (int i = 0; i < 16; ++i) {                                             \
+    for (int l = 0; l < kLanes; ++l) {                                       \
+      words[i][l] = LoadLittleEndian32(blocks[l] + 4 * i);                   \
+    }                                                                        \
+  }                                                                          \
+  alignas(64) uint32_t lanes[4][kLanes];                                     \
+  for (int j = 0; j < 4; ++j) {                                              \
+    for (int l = 0; l < kLanes; ++l) {                                       \
+      lanes[j][l] = states[4 * l + j];                                       \
+    }                                                                        \
+  }                                                                          \
+  V w[16];                                                                   \
+  for (int i = 0; i < 16; ++i) {                                             \
+    w[i] = LOAD(words[i]);                                                   \
+  }                                                                          \
+  V a = LOAD(lanes[0]);                                                      \
+  V b = LOAD(lanes[1]);                                                      \
+  V c = LOAD(lanes[2]);                                                      \
+  V d = LOAD(lanes[3]);                                                      \
+  for (int r = 0; r < 16; r += 4) {                                          \
+    RAPPOR_MD5_VSTEP(F, a, b, c, d, r, r, 7)                                 \
+    RAPPOR_MD5_VSTEP(F, d, a, b, c, r + 1, r + 1, 12)                        \
+    RAPPOR_MD5_VSTEP(F, c, d, a, b, r + 2, r + 2, 17)                        \
+    RAPPOR_MD5_VSTEP(F, b, c, d, a, r + 3, r + 3, 22)                        \
+  }                                                                          \
+  for (int r = 16; r < 32; r += 4) {                                         \
+    RAPPOR_MD5_VSTEP(G, a, b, c, d, (5 * r + 1) & 15, r, 5)                  \
+    RAPPOR_MD5_VSTEP(G, d, a, b, c, (5 * r + 6) & 15, r + 1, 9)              \
+    RAPPOR_MD5_VSTEP(G, c, d, a, b, (5 * r + 11) & 15, r + 2, 14)            \
+    RAPPOR_MD5_VSTEP(G, b, c, d, a, (5 * r + 16) & 15, r + 3, 20)            \
+  }                                                                          \
+  for (int r = 32; r < 48; r += 4) {                                         \
+    RAPPOR_MD5_VSTEP(H, a, b, c, d, (3 * r + 5) & 15, r, 4)                  \
+    RAPPOR_MD5_VSTEP(H, d, a, b, c, (3 * r + 8) & 15, r + 1, 11)             \
+    RAPPOR_MD5_VSTEP(H, c, d, a, b, (3 * r + 11) & 15, r + 2, 16)            \
+    RAPPOR_MD5_VSTEP(H, b, c, d, a, (3 * r + 14) & 15, r + 3, 23)            \
+  }                                                                          \
+  for (int r = 48; r < 64; r += 4) {                                         \
+    RAPPOR_MD5_VSTEP(I, a, b, c, d, (7 * r) & 15, r, 6)                      \
+    RAPPOR_MD5_VSTEP(I, d, a, b, c, (7 * r + 7) & 15, r + 1, 10)             \
+    RAPPOR_MD5_VSTEP(I, c, d, a, b, (7 * r + 14) & 15, r + 2, 15)            \
+    RAPPOR_MD5_VSTEP(I, b, c, d, a, (7 * r + 21) & 15, r + 3, 21)            \
+  }                                                                          \
+  STORE(lanes[0], ADD(LOAD(lanes[0]), a));                                   \
+  STORE(lanes[1], ADD(LOAD(lanes[1]), b));                                   \
+  STORE(lanes[2], ADD(LOAD(lanes[2]), c));                                   \
+  STORE(lanes[3], ADD(LOAD(lanes[3]), d));                                   \
+  for (int j = 0; j < 4; ++j) {                                              \
+    for (int l = 0; l < kLanes; ++l) {                                       \
+      states[4 * l + j] = lanes[j][l];                                       \
+    }                                                                        \
+  }
+
+typedef void LanesFunc(uint32_t*, const uint8_t* const*);
+
+#define V __m128i
+#define LOAD(p) _mm_load_si128(reinterpret_cast<const __m128i*>(p))
+#define STORE(p, x) _mm_store_si128(reinterpret_cast<__m128i*>(p), x)
+#define SET1(x) _mm_set1_epi32(static_cast<int>(x))
+#define ADD(x, y) _mm_add_epi32(x, y)
+#define ROTL(x, n) _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - (n)))
+#define F(x, y, z) _mm_xor_si128(z, _mm_and_si128(x, _mm_xor_si128(y, z)))
+#define G(x, y, z) _mm_xor_si128(y, _mm_and_si128(z, _mm_xor_si128(x, y)))
+#define H(x, y, z) _mm_xor_si128(_mm_xor_si128(x, y), z)
+#define I(x, y, z) \
+  _mm_xor_si128(y, _mm_or_si128(x, _mm_xor_si128(z, _mm_set1_epi32(-1))))
+
+__attribute__((target("sse2")))
+void Lanes4Sse2(uint32_t* states, const uint8_t* const* blocks) {
+  RAPPOR_MD5_LANES_BODY(4)
+}
+
+#undef V
+#undef LOAD
+#undef STORE
+#undef SET1
+#undef ADD
+#undef ROTL
+#undef F
+#undef G
+#undef H
+#undef I
+
+#define V __m256i
+#define LOAD(p) _mm256_load_si256(reinterpret_cast<const __m256i*>(p))
+#define STORE(p, x) _mm256_store_si256(reinterpret_cast<__m256i*>(p), x)
+#define SET1(x) _mm256_set1_epi32(static_cast<int>(x))
+#define ADD(x, y) _mm256_add_epi32(x, y)
+#define ROTL(x, n) \
+  _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - (n)))
+#define F(x, y, z) \
+  _mm256_xor_si256(z, _mm256_and_si256(x, _mm256_xor_si256(y, z)))
+#define G(x, y, z) \
+  _mm256_xor_si256(y, _mm256_and_si256(z, _mm256_xor_si256(x, y)))
+#define H(x, y, z) _mm256_xor_si256(_mm256_xor_si256(x, y), z)
+#define I(x, y, z)                 \
+  _mm256_xor_si256(y, _mm256_or_si256( \
+      x, _mm256_xor_si256(z, _mm256_set1_epi32(-1))))
+
+__attribute__((target("avx2")))
+void Lanes8Avx2(uint32_t* states, const uint8_t* const* blocks) {
+  RAPPOR_MD5_LANES_BODY(8)
+}
+
+#undef V
+#undef LOAD
+#undef STORE
+#undef SET1
+#undef ADD
+#undef ROTL
+#undef F
+#undef G
+#undef H
+#undef I
+
+// AVX-512 has a rotate instruction, and each round function is a single
+// ternary-logic instruction.
+#define V __m512i
+#define LOAD(p) _mm512_load_si512(p)
+#define STORE(p, x) _mm512_store_si512(p, x)
+#define SET1(x) _mm512_set1_epi32(static_cast<int>(x))
+#define ADD(x, y) _mm512_add_epi32(x, y)
+// The all-lanes maskz form avoids GCC's uninitialized-value warning about the
+// placeholder operand of the unmasked rotate intrinsic.
+#define ROTL(x, n) _mm512_maskz_rol_epi32(0xFFFF, x, n)
+#define F(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0xCA)
+#define G(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0xE4)
+#define H(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0x96)
+#define I(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0x39)
+
+__attribute__((target("avx512f")))
+void Lanes16Avx512(uint32_t* states, const uint8_t* const* blocks) {
+  RAPPOR_MD5_LANES_BODY(16)
+}
+
+#undef V
+#undef LOAD
+#undef STORE
+#undef SET1
+#undef ADD
+#undef ROTL
+#undef F
+#undef G
+#undef H
+#undef I
+#undef RAPPOR_MD5_LANES_BODY
+#undef RAPPOR_MD5_VSTEP
+
+LanesFunc* SelectLanes16() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx512f") ? Lanes16Avx512 : nullptr;
+}
+
+LanesFunc* SelectLanes8() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? Lanes8Avx2 : nullptr;
+}
+
+LanesFunc* SelectLanes4() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse2") ? Lanes4Sse2 : nullptr;
+}
+
+#endif  // RAPPOR_MD5_X86
+
+}  // namespace
+
+void Md5Compress(uint32_t* state, const uint8_t* blocks, size_t num_blocks) {
+  for (size_t i = 0; i < num_blocks; ++i) {
+    Compress(state, blocks + i * Md5Context::kBlockSize);
+  }
+}
+
+void Md5CompressLanes(uint32_t* states, const uint8_t* const* blocks,
+                      size_t num_lanes) {
+#ifdef RAPPOR_MD5_X86
+  static LanesFunc* const lanes16 = SelectLanes16();
+  static LanesFunc* const lanes8 = SelectLanes8();
+  static LanesFunc* const lanes4 = SelectLanes4();
+  if (lanes16) {
+    for (; num_lanes >= 16; num_lanes -= 16, states += 4 * 16, blocks += 16) {
+      lanes16(states, blocks);
+    }
+  }
+  if (lanes8) {
+    for (; num_lanes >= 8; num_lanes -= 8, states += 4 * 8, blocks += 8) {
+      lanes8(states, blocks);
+    }
+  }
+  if (lanes4) {
+    for (; num_lanes >= 4; num_lanes -= 4, states += 4 * 4, blocks += 4) {
+      lanes4(states, blocks);
+    }
+  }
+#endif
+  for (size_t i = 0; i < num_lanes; ++i) {
+    Compress(states + 4 * i, blocks[i]);
+  }
+}
+
+Md5Context::Md5Context() : length_(0), buffered_(0) {
+  memcpy(state_, kMd5InitialState, sizeof(state_));
+}
+
+void Md5Context::Hash(const void* data, size_t len, uint8_t* digest) {
+  Md5Context md5;
+  md5.Update(data, len);
+  md5.Final(digest);
+}
+
+void Md5Context::Update(const void* data, size_t len) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  length_ += len;
+
+  if (buffered_ > 0) {
+    size_t n = kBlockSize - buffered_;
+    if (n > len) {
+      n = len;
+    }
+    memcpy(buffer_ + buffered_, p, n);
+    buffered_ += n;
+    p += n;
+    len -= n;
+    if (buffered_ < kBlockSize) {
+      return;
+    }
+    Compress(state_, buffer_);
+    buffered_ = 0;
+  }
+
+  while (len >= kBlockSize) {
+    Compress(state_, p);
+    p += kBlockSize;
+    len -= kBlockSize;
+  }
+
+  if (len > 0) {
+    memcpy(buffer_, p, len);
+    buffered_ = len;
+  }
+}
+
+void Md5Context::Final(uint8_t* digest) {
+  uint64_t bit_length = length_ * 8;
+
+  // Append 0x80, pad with zeros to 56 mod 64, then the little-endian length.
+  buffer_[buffered_++] = 0x80;
+  if (buffered_ > kBlockSize - 8) {
+    memset(buffer_ + buffered_, 0, kBlockSize - buffered_);
+    Compress(state_, buffer_);
+    buffered_ = 0;
+  }
+  memset(buffer_ + buffered_, 0, kBlockSize - 8 - buffered_);
+  StoreLittleEndian32(static_cast<uint32_t>(bit_length), buffer_ + 56);
+  StoreLittleEndian32(static_cast<uint32_t>(bit_length >> 32), buffer_ + 60);
+  Compress(state_, buffer_);
+
+  for (int i = 0; i < 4; ++i) {
+    StoreLittleEndian32(state_[i], digest + 4 * i);
+  }
+}
+
+}  // namespace rappor
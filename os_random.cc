@@ -0,0 +1,110 @@
+#include "qt-rappor-client/os_random.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <random>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#define RAPPOR_HAVE_UNISTD 1
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<sys/random.h>)
+#include <sys/random.h>
+#define RAPPOR_HAVE_GETRANDOM 1
+#endif
+#endif
+
+namespace rappor {
+
+namespace {
+
+std::atomic<uint32_t> s_fork_generation{0};
+
+#ifdef RAPPOR_HAVE_UNISTD
+void OnForkChild() {
+  s_fork_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Reads the rest of [out, out + len) from /dev/urandom.
+size_t ReadUrandom(uint8_t* out, size_t len) {
+  int fd;
+  do {
+    fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+  } while (fd < 0 && errno == EINTR);
+  if (fd < 0) {
+    return len;
+  }
+  while (len > 0) {
+    ssize_t n = read(fd, out, len);
+    if (n > 0) {
+      out += n;
+      len -= static_cast<size_t>(n);
+    } else if (n == 0 || errno != EINTR) {
+      break;
+    }
+  }
+  close(fd);
+  return len;
+}
+#endif
+
+// Fills [out, out + len) from std::random_device.
+void RandomDevice(uint8_t* out, size_t len) {
+  // This should be a hardware-backed source according to the spec
+  std::random_device device;
+  while (len > 0) {
+    uint32_t word = device();
+    size_t n = len < sizeof(word) ? len : sizeof(word);
+    memcpy(out, &word, n);
+    out += n;
+    len -= n;
+  }
+}
+
+}  // namespace
+
+size_t KernelRandom(uint8_t* out, size_t len) {
+#ifdef RAPPOR_HAVE_GETRANDOM
+  while (len > 0) {
+    ssize_t n = getrandom(out, len, 0);
+    if (n > 0) {
+      out += n;
+      len -= static_cast<size_t>(n);
+    } else if (n < 0 && errno != EINTR) {
+      break;  // e.g. ENOSYS on old kernels
+    }
+  }
+#endif
+#ifdef RAPPOR_HAVE_UNISTD
+  if (len > 0) {
+    len = ReadUrandom(out, len);
+  }
+#else
+  RandomDevice(out, len);
+  len = 0;
+#endif
+  return len;
+}
+
+void OsRandom(uint8_t* out, size_t len) {
+  size_t missing = KernelRandom(out, len);
+  RandomDevice(out + len - missing, missing);
+}
+
+void RegisterForkHandler() {
+#ifdef RAPPOR_HAVE_UNISTD
+  static const int registered = pthread_atfork(nullptr, nullptr, OnForkChild);
+  Q_UNUSED(registered);
+#endif
+}
+
+uint32_t ForkGeneration() {
+  return s_fork_generation.load(std::memory_order_relaxed);
+}
+
+}  // namespace rappor
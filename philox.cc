@@ -0,0 +1,136 @@
+#include "qt-rappor-client/philox.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define RAPPOR_PHILOX_X86 1
+#include <immintrin.h>
+#endif
+
+namespace rappor {
+
+namespace {
+
+typedef void BlocksFunc(const uint32_t*, const uint32_t*, size_t, uint32_t*);
+
+const uint32_t kMultiplier0 = 0xD2511F53;
+const uint32_t kMultiplier1 = 0xCD9E8D57;
+const uint32_t kWeyl0 = 0x9E3779B9;
+const uint32_t kWeyl1 = 0xBB67AE85;
+const int kRounds = 10;
+
+#ifdef RAPPOR_PHILOX_X86
+
+// Lane j of c[i] holds counter word i of block j.  _mm256_mul_epu32 only
+// multiplies the even lanes, so the odd lanes go through a second multiply
+// after shifting them down.
+__attribute__((target("avx2")))
+inline void MulHiLo(__m256i a, __m256i multiplier, __m256i* hi, __m256i* lo) {
+  __m256i even = _mm256_mul_epu32(a, multiplier);
+  __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), multiplier);
+  *lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+  *hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+__attribute__((target("avx2")))
+void BlocksAvx2(const uint32_t* key, const uint32_t* counter,
+                size_t num_blocks, uint32_t* out) {
+  const __m256i m0 = _mm256_set1_epi32(static_cast<int>(kMultiplier0));
+  const __m256i m1 = _mm256_set1_epi32(static_cast<int>(kMultiplier1));
+
+  uint32_t first = counter[0];
+  for (; num_blocks >= 8; num_blocks -= 8, first += 8) {
+    __m256i c0 = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(first)),
+                                  _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256i c1 = _mm256_set1_epi32(static_cast<int>(counter[1]));
+    __m256i c2 = _mm256_set1_epi32(static_cast<int>(counter[2]));
+    __m256i c3 = _mm256_set1_epi32(static_cast<int>(counter[3]));
+    uint32_t k0 = key[0];
+    uint32_t k1 = key[1];
+    for (int round = 0; round < kRounds; ++round) {
+      __m256i hi0, lo0, hi1, lo1;
+      MulHiLo(c0, m0, &hi0, &lo0);
+      MulHiLo(c2, m1, &hi1, &lo1);
+      c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1),
+                            _mm256_set1_epi32(static_cast<int>(k0)));
+      c1 = lo1;
+      c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3),
+                            _mm256_set1_epi32(static_cast<int>(k1)));
+      c3 = lo0;
+      k0 += kWeyl0;
+      k1 += kWeyl1;
+    }
+    // Transpose to 8 consecutive 4-word blocks.
+    __m256i t0 = _mm256_unpacklo_epi32(c0, c1);  // blocks 0 1 | 4 5, words 0 1
+    __m256i t1 = _mm256_unpackhi_epi32(c0, c1);  // blocks 2 3 | 6 7
+    __m256i t2 = _mm256_unpacklo_epi32(c2, c3);  // blocks 0 1 | 4 5, words 2 3
+    __m256i t3 = _mm256_unpackhi_epi32(c2, c3);
+    __m256i b01 = _mm256_unpacklo_epi64(t0, t2);  // block 0 | block 4
+    __m256i b11 = _mm256_unpackhi_epi64(t0, t2);  // block 1 | block 5
+    __m256i b21 = _mm256_unpacklo_epi64(t1, t3);  // block 2 | block 6
+    __m256i b31 = _mm256_unpackhi_epi64(t1, t3);  // block 3 | block 7
+    __m256i* dst = reinterpret_cast<__m256i*>(out);
+    _mm256_storeu_si256(dst, _mm256_permute2x128_si256(b01, b11, 0x20));
+    _mm256_storeu_si256(dst + 1, _mm256_permute2x128_si256(b21, b31, 0x20));
+    _mm256_storeu_si256(dst + 2, _mm256_permute2x128_si256(b01, b11, 0x31));
+    _mm256_storeu_si256(dst + 3, _mm256_permute2x128_si256(b21, b31, 0x31));
+    out += 8 * 4;
+  }
+
+  // GCC does not always clear the upper halves itself here, and leaving
+  // them dirty slows down the SSE code that runs after this kernel.
+  _mm256_zeroupper();
+  const uint32_t rest[4] = { first, counter[1], counter[2], counter[3] };
+  Philox4x32Scalar(key, rest, num_blocks, out);
+}
+
+BlocksFunc* SelectBlocks() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return BlocksAvx2;
+  }
+  return Philox4x32Scalar;
+}
+
+#else
+
+BlocksFunc* SelectBlocks() {
+  return Philox4x32Scalar;
+}
+
+#endif  // RAPPOR_PHILOX_X86
+
+}  // namespace
+
+void Philox4x32Scalar(const uint32_t* key, const uint32_t* counter,
+                      size_t num_blocks, uint32_t* out) {
+  for (size_t block = 0; block < num_blocks; ++block) {
+    uint32_t c0 = counter[0] + static_cast<uint32_t>(block);
+    uint32_t c1 = counter[1];
+    uint32_t c2 = counter[2];
+    uint32_t c3 = counter[3];
+    uint32_t k0 = key[0];
+    uint32_t k1 = key[1];
+    for (int round = 0; round < kRounds; ++round) {
+      uint64_t p0 = static_cast<uint64_t>(kMultiplier0) * c0;
+      uint64_t p1 = static_cast<uint64_t>(kMultiplier1) * c2;
+      c0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+      c1 = static_cast<uint32_t>(p1);
+      c2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+      c3 = static_cast<uint32_t>(p0);
+      k0 += kWeyl0;
+      k1 += kWeyl1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+    out += 4;
+  }
+}
+
+void Philox4x32(const uint32_t* key, const uint32_t* counter,
+                size_t num_blocks, uint32_t* out) {
+  static BlocksFunc* const blocks = SelectBlocks();
+  blocks(key, counter, num_blocks, out);
+}
+
+}  // namespace rappor
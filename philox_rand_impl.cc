@@ -0,0 +1,69 @@
+#include "qt-rappor-client/philox_rand_impl.h"
+
+#include "qt-rappor-client/bitsliced_mask.h"
+#include "qt-rappor-client/philox.h"
+
+namespace rappor {
+
+namespace {
+
+// One kernel call: 8 blocks, 32 words, of which 28 make two bitsliced masks.
+const uint32_t kChunkBlocks = 8;
+
+}  // namespace
+
+PhiloxRand::PhiloxRand(uint64_t seed, uint64_t client_id, uint32_t report_index)
+{
+    m_key[0] = static_cast<uint32_t>(seed);
+    m_key[1] = static_cast<uint32_t>(seed >> 32);
+    m_stream[0] = report_index;
+    m_stream[1] = static_cast<uint32_t>(client_id);
+    m_stream[2] = static_cast<uint32_t>(client_id >> 32);
+}
+
+uint64_t PhiloxRand::ClientId(std::string_view client)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : client) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+void PhiloxRand::GetMask(float prob, int num_bits, Bits* mask_out) const
+{
+    uint32_t counter[4] = { m_nextBlock.fetch_add(kChunkBlocks),
+                            m_stream[0], m_stream[1], m_stream[2] };
+    uint32_t random[kChunkBlocks * 4];
+    Philox4x32(m_key, counter, kChunkBlocks, random);
+    *mask_out = BitslicedMaskFromWords(Threshold128(prob), random) & LowBits(num_bits);
+}
+
+void PhiloxRand::GetMasks(float prob_p, float prob_q, int num_bits,
+                          Bits* p_out, Bits* q_out) const
+{
+    const uint32_t p_threshold = Threshold128(prob_p);
+    const uint32_t q_threshold = Threshold128(prob_q);
+
+    // Each chunk covers 2 words of p and q.
+    const uint32_t chunks = static_cast<uint32_t>((num_bits + 63) / 64);
+    uint32_t counter[4] = { m_nextBlock.fetch_add(chunks * kChunkBlocks),
+                            m_stream[0], m_stream[1], m_stream[2] };
+    uint32_t random[kChunkBlocks * 4];
+    for (int i = 0; num_bits > 0; i += 2, num_bits -= 64) {
+        Philox4x32(m_key, counter, kChunkBlocks, random);
+        counter[0] += kChunkBlocks;
+
+        p_out[i] = BitslicedMaskFromWords(p_threshold, random) & LowBits(num_bits);
+        q_out[i] = BitslicedMaskFromWords(q_threshold, random + 7) & LowBits(num_bits);
+        if (num_bits > 32) {
+            p_out[i + 1] = BitslicedMaskFromWords(p_threshold, random + 14)
+                & LowBits(num_bits - 32);
+            q_out[i + 1] = BitslicedMaskFromWords(q_threshold, random + 21)
+                & LowBits(num_bits - 32);
+        }
+    }
+}
+
+}  // namespace rappor
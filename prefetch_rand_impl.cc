@@ -0,0 +1,192 @@
+#include "qt-rappor-client/prefetch_rand_impl.h"
+
+#include <chrono>
+#include <utility>
+
+namespace rappor {
+
+PrefetchRand::PrefetchRand(std::shared_ptr<IrrRandInterface> source,
+                           size_t capacity)
+    : m_source(std::move(source))
+    , m_capacity([capacity] {
+          size_t n = 2;
+          while (n < capacity) {
+              n *= 2;
+          }
+          return n;
+      }())
+{
+    m_thread = std::thread(&PrefetchRand::RefillLoop, this);
+}
+
+PrefetchRand::~PrefetchRand()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeup.notify_one();
+    m_thread.join();
+}
+
+void PrefetchRand::GetMask(float prob, int num_bits, Bits* mask_out) const
+{
+    m_source->GetMask(prob, num_bits, mask_out);
+}
+
+void PrefetchRand::GetMasks(float prob_p, float prob_q, int num_bits,
+                            Bits* p_out, Bits* q_out) const
+{
+    Stream* stream = FindStream(prob_p, prob_q, num_bits);
+    if (stream && Pop(*stream, p_out, q_out)) {
+        m_prefetched.fetch_add(1, std::memory_order_relaxed);
+        if (Occupancy(*stream) < m_capacity / 2) {
+            RequestRefill();
+        }
+        return;
+    }
+
+    if (stream) {
+        m_underflows.fetch_add(1, std::memory_order_relaxed);
+        RequestRefill();
+    }
+    m_source->GetMasks(prob_p, prob_q, num_bits, p_out, q_out);
+}
+
+PrefetchRand::Stream* PrefetchRand::FindStream(float prob_p, float prob_q,
+                                               int num_bits) const
+{
+    if (num_bits <= 0 || num_bits > kMaxBits) {
+        return nullptr;
+    }
+    for (Stream& stream : m_streams) {
+        int state = stream.state.load(std::memory_order_acquire);
+        if (state == Stream::kReady) {
+            if (stream.prob_p == prob_p && stream.prob_q == prob_q
+                && stream.num_bits == num_bits) {
+                return &stream;
+            }
+            continue;
+        }
+        if (state == Stream::kInitializing) {
+            continue;
+        }
+
+        // Claim an empty slot for these parameters.
+        if (!stream.state.compare_exchange_strong(state, Stream::kInitializing,
+                                                  std::memory_order_acquire)) {
+            continue;  // someone else took it; it may be for other params
+        }
+        stream.prob_p = prob_p;
+        stream.prob_q = prob_q;
+        stream.num_bits = num_bits;
+        stream.cells.reset(new Cell[m_capacity]);
+        for (size_t i = 0; i < m_capacity; ++i) {
+            stream.cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        stream.state.store(Stream::kReady, std::memory_order_release);
+        return &stream;
+    }
+    return nullptr;  // all streams are in use
+}
+
+// Consumers: any encoding thread.
+bool PrefetchRand::Pop(Stream& stream, Bits* p_out, Bits* q_out) const
+{
+    const size_t mask = m_capacity - 1;
+    size_t pos = stream.dequeue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = stream.cells[pos & mask];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0) {
+            if (stream.dequeue_pos.compare_exchange_weak(
+                    pos, pos + 1, std::memory_order_relaxed)) {
+                const int words = (stream.num_bits + 31) / 32;
+                for (int i = 0; i < words; ++i) {
+                    p_out[i] = cell.p[i];
+                    q_out[i] = cell.q[i];
+                }
+                cell.sequence.store(pos + m_capacity, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;  // empty
+        } else {
+            pos = stream.dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// Producer: the refill thread only.
+bool PrefetchRand::Push(Stream& stream)
+{
+    const size_t mask = m_capacity - 1;
+    size_t pos = stream.enqueue_pos.load(std::memory_order_relaxed);
+    Cell& cell = stream.cells[pos & mask];
+    size_t seq = cell.sequence.load(std::memory_order_acquire);
+    if (seq != pos) {
+        return false;  // full
+    }
+    stream.enqueue_pos.store(pos + 1, std::memory_order_relaxed);
+    m_source->GetMasks(stream.prob_p, stream.prob_q, stream.num_bits,
+                       cell.p, cell.q);
+    cell.sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+size_t PrefetchRand::Occupancy(const Stream& stream) const
+{
+    size_t enqueued = stream.enqueue_pos.load(std::memory_order_relaxed);
+    size_t dequeued = stream.dequeue_pos.load(std::memory_order_relaxed);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+}
+
+void PrefetchRand::RequestRefill() const
+{
+    // Only the first request until the refill thread runs pays for a wakeup.
+    if (!m_refillRequested.exchange(true, std::memory_order_relaxed)) {
+        m_wakeup.notify_one();
+    }
+}
+
+void PrefetchRand::RefillLoop()
+{
+    for (;;) {
+        for (Stream& stream : m_streams) {
+            if (stream.state.load(std::memory_order_acquire) != Stream::kReady) {
+                continue;
+            }
+            while (Push(stream)) {
+                m_refilled.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        // The timeout picks up streams created without a refill request.
+        m_wakeup.wait_for(lock, std::chrono::milliseconds(100), [this] {
+            return m_stop || m_refillRequested.load(std::memory_order_relaxed);
+        });
+        if (m_stop) {
+            return;
+        }
+        m_refillRequested.store(false, std::memory_order_relaxed);
+    }
+}
+
+PrefetchRand::Stats PrefetchRand::stats() const
+{
+    Stats stats = {};
+    stats.refilled = m_refilled.load(std::memory_order_relaxed);
+    stats.prefetched = m_prefetched.load(std::memory_order_relaxed);
+    stats.underflows = m_underflows.load(std::memory_order_relaxed);
+    for (const Stream& stream : m_streams) {
+        if (stream.state.load(std::memory_order_acquire) == Stream::kReady) {
+            stats.occupancy += Occupancy(stream);
+            stats.capacity += m_capacity;
+        }
+    }
+    return stats;
+}
+
+}  // namespace rappor
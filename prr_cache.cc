@@ -0,0 +1,174 @@
+#include "qt-rappor-client/prr_cache.h"
+
+#include <algorithm>
+
+namespace rappor {
+
+// Node indices are 32 bits.
+static const size_t kMaxLruEntries = size_t(1) << 30;
+
+PrrCache::PrrCache(int num_bits, size_t max_entries)
+    : max_entries_(std::min(max_entries, kMaxLruEntries)),
+      dense_size_(0),
+      lru_size_(0),
+      head_(kNone),
+      tail_(kNone),
+      slot_mask_(0) {
+  if (num_bits < 32 && (size_t(1) << num_bits) <= max_entries) {
+    dense_size_ = size_t(1) << num_bits;
+    dense_.reset(new std::atomic<uint64_t>[dense_size_]());
+  } else if (max_entries_ > 0) {
+    // At most half full, so probe sequences stay short.
+    size_t num_slots = 1;
+    while (num_slots < 2 * max_entries_) {
+      num_slots *= 2;
+    }
+    nodes_.reset(new Node[max_entries_]);
+    slots_.reset(new uint32_t[num_slots]());
+    slot_mask_ = num_slots - 1;
+  }
+}
+
+size_t PrrCache::Home(Bits bits) const {
+  return static_cast<size_t>((bits * 0x9e3779b97f4a7c15ULL) >> 32) &
+         slot_mask_;
+}
+
+size_t PrrCache::FindSlot(Bits bits) const {
+  for (size_t slot = Home(bits);; slot = (slot + 1) & slot_mask_) {
+    uint32_t node = slots_[slot];
+    if (node == 0) {
+      return kNoSlot;
+    }
+    if (nodes_[node - 1].bits == bits) {
+      return slot;
+    }
+  }
+}
+
+// Linear-probing deletion: shift later entries of the probe run back into
+// the hole when their home slot allows it, instead of leaving tombstones.
+void PrrCache::EraseSlot(size_t slot) {
+  size_t hole = slot;
+  for (size_t s = (hole + 1) & slot_mask_; slots_[s] != 0;
+       s = (s + 1) & slot_mask_) {
+    size_t home = Home(nodes_[slots_[s] - 1].bits);
+    if (((s - home) & slot_mask_) >= ((s - hole) & slot_mask_)) {
+      slots_[hole] = slots_[s];
+      hole = s;
+    }
+  }
+  slots_[hole] = 0;
+}
+
+void PrrCache::Unlink(uint32_t node) {
+  Node& n = nodes_[node];
+  if (n.prev != kNone) {
+    nodes_[n.prev].next = n.next;
+  } else {
+    head_ = n.next;
+  }
+  if (n.next != kNone) {
+    nodes_[n.next].prev = n.prev;
+  } else {
+    tail_ = n.prev;
+  }
+}
+
+void PrrCache::PushFront(uint32_t node) {
+  Node& n = nodes_[node];
+  n.prev = kNone;
+  n.next = head_;
+  if (head_ != kNone) {
+    nodes_[head_].prev = node;
+  } else {
+    tail_ = node;
+  }
+  head_ = node;
+}
+
+bool PrrCache::Lookup(Bits bits, Bits* uniform, Bits* f_mask) {
+  uint64_t entry;
+  if (dense()) {
+    if (bits >= dense_size_) {
+      return false;
+    }
+    // Entries are a pure function of bits, so a relaxed load sees either
+    // nothing or the right value.
+    entry = dense_[bits].load(std::memory_order_relaxed);
+    if (!(entry & kFilled)) {
+      return false;
+    }
+    entry &= ~kFilled;
+  } else {
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+      return false;  // recomputing is cheaper than waiting
+    }
+    if (max_entries_ == 0) {
+      return false;
+    }
+    size_t slot = FindSlot(bits);
+    if (slot == kNoSlot) {
+      return false;
+    }
+    uint32_t node = slots_[slot] - 1;
+    Unlink(node);  // mark as most recent
+    PushFront(node);
+    entry = nodes_[node].entry;
+  }
+
+  *uniform = static_cast<Bits>(entry >> 32);
+  *f_mask = static_cast<Bits>(entry);
+  return true;
+}
+
+void PrrCache::Insert(Bits bits, Bits uniform, Bits f_mask) {
+  if (dense()) {
+    if (bits < dense_size_) {
+      dense_[bits].store(kFilled | Pack(uniform, f_mask),
+                         std::memory_order_relaxed);
+    }
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return;
+  }
+
+  if (max_entries_ == 0 || FindSlot(bits) != kNoSlot) {
+    return;
+  }
+  uint32_t node;
+  if (lru_size_ < max_entries_) {
+    node = static_cast<uint32_t>(lru_size_++);
+  } else {
+    node = tail_;  // evict the least recently used
+    EraseSlot(FindSlot(nodes_[node].bits));
+    Unlink(node);
+  }
+  nodes_[node].bits = bits;
+  nodes_[node].entry = Pack(uniform, f_mask);
+  PushFront(node);
+
+  size_t slot = Home(bits);
+  while (slots_[slot] != 0) {
+    slot = (slot + 1) & slot_mask_;
+  }
+  slots_[slot] = node + 1;
+}
+
+size_t PrrCache::size() const {
+  if (dense()) {
+    size_t filled = 0;
+    for (size_t i = 0; i < dense_size_; ++i) {
+      filled += (dense_[i].load(std::memory_order_relaxed) & kFilled) ? 1 : 0;
+    }
+    return filled;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  return lru_size_;
+}
+
+}  // namespace rappor
@@ -0,0 +1,119 @@
+#include "qt-rappor-client/prr_masks.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define RAPPOR_PRR_MASKS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace rappor {
+
+namespace {
+
+typedef void ExtractFunc(const uint8_t*, int, uint8_t, uint64_t*, uint64_t*);
+
+// Scalar loop for bytes [begin, num_bits), OR-ing into zeroed words.
+void ExtractRange(const uint8_t* bytes, int begin, int num_bits,
+                  uint8_t threshold128, uint64_t* uniform_out,
+                  uint64_t* f_mask_out) {
+  for (int i = begin; i < num_bits; ++i) {
+    uint8_t byte = bytes[i];
+    uint64_t u_bit = byte & 0x01;  // 1 bit of entropy
+    uint8_t rand128 = byte >> 1;  // 7 bits of entropy
+    uint64_t noise_bit = (rand128 < threshold128);
+    uniform_out[i / 64] |= u_bit << (i % 64);
+    f_mask_out[i / 64] |= noise_bit << (i % 64);
+  }
+}
+
+void ZeroWords(int num_bits, uint64_t* uniform_out, uint64_t* f_mask_out) {
+  for (int w = 0; w < (num_bits + 63) / 64; ++w) {
+    uniform_out[w] = 0;
+    f_mask_out[w] = 0;
+  }
+}
+
+#ifdef RAPPOR_PRR_MASKS_X86
+
+// rand128 < threshold128  <=>  byte < 2 * threshold128  <=>  byte <= limit,
+// which SSE expresses as min(byte, limit) == byte.  threshold128 == 0 never
+// matches and is handled by the caller.
+
+__attribute__((target("sse2")))
+void ExtractSse2(const uint8_t* bytes, int num_bits, uint8_t threshold128,
+                 uint64_t* uniform_out, uint64_t* f_mask_out) {
+  ZeroWords(num_bits, uniform_out, f_mask_out);
+  const __m128i limit = _mm_set1_epi8(static_cast<char>(2 * threshold128 - 1));
+  const bool any_f = threshold128 != 0;
+
+  int i = 0;
+  for (; i + 16 <= num_bits; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+    // Shifting 16-bit lanes left by 7 moves each byte's low bit to its top.
+    uint64_t u = static_cast<uint16_t>(_mm_movemask_epi8(_mm_slli_epi16(v, 7)));
+    uint64_t f = any_f ? static_cast<uint16_t>(_mm_movemask_epi8(
+                             _mm_cmpeq_epi8(_mm_min_epu8(v, limit), v)))
+                       : 0;
+    uniform_out[i / 64] |= u << (i % 64);
+    f_mask_out[i / 64] |= f << (i % 64);
+  }
+  ExtractRange(bytes, i, num_bits, threshold128, uniform_out, f_mask_out);
+}
+
+__attribute__((target("avx2")))
+void ExtractAvx2(const uint8_t* bytes, int num_bits, uint8_t threshold128,
+                 uint64_t* uniform_out, uint64_t* f_mask_out) {
+  ZeroWords(num_bits, uniform_out, f_mask_out);
+  const __m256i limit =
+      _mm256_set1_epi8(static_cast<char>(2 * threshold128 - 1));
+  const bool any_f = threshold128 != 0;
+
+  int i = 0;
+  for (; i + 32 <= num_bits; i += 32) {
+    __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + i));
+    uint64_t u = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_slli_epi16(v, 7)));
+    uint64_t f = any_f ? static_cast<uint32_t>(_mm256_movemask_epi8(
+                             _mm256_cmpeq_epi8(_mm256_min_epu8(v, limit), v)))
+                       : 0;
+    uniform_out[i / 64] |= u << (i % 64);
+    f_mask_out[i / 64] |= f << (i % 64);
+  }
+  ExtractRange(bytes, i, num_bits, threshold128, uniform_out, f_mask_out);
+}
+
+ExtractFunc* SelectExtract() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return ExtractAvx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return ExtractSse2;
+  }
+  return ExtractPrrMasksScalar;
+}
+
+#else
+
+ExtractFunc* SelectExtract() {
+  return ExtractPrrMasksScalar;
+}
+
+#endif  // RAPPOR_PRR_MASKS_X86
+
+}  // namespace
+
+void ExtractPrrMasksScalar(const uint8_t* bytes, int num_bits,
+                           uint8_t threshold128, uint64_t* uniform_out,
+                           uint64_t* f_mask_out) {
+  ZeroWords(num_bits, uniform_out, f_mask_out);
+  ExtractRange(bytes, 0, num_bits, threshold128, uniform_out, f_mask_out);
+}
+
+void ExtractPrrMasks(const uint8_t* bytes, int num_bits, uint8_t threshold128,
+                     uint64_t* uniform_out, uint64_t* f_mask_out) {
+  static ExtractFunc* const extract = SelectExtract();
+  extract(bytes, num_bits, threshold128, uniform_out, f_mask_out);
+}
+
+}  // namespace rappor
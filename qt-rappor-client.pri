@@ -3,11 +3,50 @@
 INCLUDEPATH += $$PWD/..
 
 SOURCES += \
+    $$PWD/async_encoder.cc \
+    $$PWD/bloom_cache.cc \
+    $$PWD/chacha20.cc \
+    $$PWD/chacha_rand_impl.cc \
+    $$PWD/encode_stream.cc \
     $$PWD/encoder.cc \
+    $$PWD/encoder_registry.cc \
+    $$PWD/enum_encoder.cc \
+    $$PWD/kernel_rand_impl.cc \
+    $$PWD/md5.cc \
+    $$PWD/os_random.cc \
+    $$PWD/philox.cc \
+    $$PWD/philox_rand_impl.cc \
+    $$PWD/prefetch_rand_impl.cc \
+    $$PWD/prr_cache.cc \
+    $$PWD/prr_masks.cc \
     $$PWD/qt_hash_impl.cc \
+    $$PWD/report_coalescer.cc \
+    $$PWD/sha256.cc \
     $$PWD/std_rand_impl.cc \
 
 HEADERS += \
-    $$PWD/encoder.h \
-    $$PWD/qt_hash_impl.h \
-    $$PWD/std_rand_impl.h \
+    $$PWD/qt-rappor-client/async_encoder.h \
+    $$PWD/qt-rappor-client/bits.h \
+    $$PWD/qt-rappor-client/bitsliced_mask.h \
+    $$PWD/qt-rappor-client/bloom_cache.h \
+    $$PWD/qt-rappor-client/chacha20.h \
+    $$PWD/qt-rappor-client/chacha_rand_impl.h \
+    $$PWD/qt-rappor-client/encode_stream.h \
+    $$PWD/qt-rappor-client/encoder.h \
+    $$PWD/qt-rappor-client/encoder_registry.h \
+    $$PWD/qt-rappor-client/enum_encoder.h \
+    $$PWD/qt-rappor-client/kernel_rand_impl.h \
+    $$PWD/qt-rappor-client/md5.h \
+    $$PWD/qt-rappor-client/os_random.h \
+    $$PWD/qt-rappor-client/philox.h \
+    $$PWD/qt-rappor-client/philox_rand_impl.h \
+    $$PWD/qt-rappor-client/prefetch_rand_impl.h \
+    $$PWD/qt-rappor-client/prr_cache.h \
+    $$PWD/qt-rappor-client/prr_masks.h \
+    $$PWD/qt-rappor-client/qt_hash_impl.h \
+    $$PWD/qt-rappor-client/qt_rappor_global.h \
+    $$PWD/qt-rappor-client/rappor_deps.h \
+    $$PWD/qt-rappor-client/report_coalescer.h \
+    $$PWD/qt-rappor-client/sha256.h \
+    $$PWD/qt-rappor-client/static_encoder.h \
+    $$PWD/qt-rappor-client/std_rand_impl.h \
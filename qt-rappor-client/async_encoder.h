@@ -0,0 +1,46 @@
+// Encoding on a QThreadPool, with results delivered through QFuture.
+
+#pragma once
+
+#include "qt_rappor_global.h"
+
+#include <string>
+#include <vector>
+
+#include <QFuture>
+#include <QVector>
+
+#include "encoder.h"
+
+class QThreadPool;
+
+namespace rappor {
+
+// AsyncEncoder runs an Encoder's work (MD5, HMAC, IRR) on a thread pool, so
+// latency-sensitive threads such as the UI thread don't wait for it.  Reports
+// are identical to calling the Encoder directly.
+//
+// Pool threads are long-lived, so each reuses the encoder's per-thread
+// scratch buffers from task to task.  A failed encode finishes the future
+// canceled, without a result: after waitForFinished(), check isCanceled()
+// before calling result().
+class QT_RAPPOR_EXPORT AsyncEncoder {
+ public:
+  // encoder and pool are held by pointer and must outlive any pending
+  // futures.  With no pool, QThreadPool::globalInstance() is used.
+  explicit AsyncEncoder(const Encoder* encoder, QThreadPool* pool = nullptr);
+
+  QFuture<Bits> EncodeStringAsync(std::string value) const;
+  QFuture<Bits> EncodeBitsAsync(Bits bits) const;
+
+  // Encodes all values, split across the pool's threads.  The result holds
+  // one IRR per value, in order.
+  QFuture<QVector<Bits>> EncodeStringsAsync(
+      std::vector<std::string> values) const;
+
+ private:
+  const Encoder* encoder_;
+  QThreadPool* pool_;
+};
+
+}  // namespace rappor
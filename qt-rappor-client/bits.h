@@ -0,0 +1,121 @@
+// Fixed-width RAPPOR reports wider than rappor::Bits.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace rappor {
+
+// A report of N bits, N a multiple of 64.  Bit i is bit (i % 64) of lane
+// i / 64, so BasicBits<64> holds the same value as a uint64_t would.
+//
+// The bitwise operators loop over a fixed number of 64-bit lanes, which the
+// compiler unrolls and vectorizes for the PRR and IRR composition.
+template <int N>
+class BasicBits {
+  static_assert(N > 0 && N % 64 == 0, "N must be a positive multiple of 64");
+
+ public:
+  static constexpr int kNumBits = N;
+  static constexpr int kNumLanes = N / 64;
+  static constexpr int kNumBytes = N / 8;
+
+  BasicBits() : lanes_() {}
+  // The low 64 bits; the rest are zero.
+  explicit BasicBits(uint64_t low) : lanes_() { lanes_[0] = low; }
+
+  bool test(int i) const { return (lanes_[i / 64] >> (i % 64)) & 1; }
+  void set(int i) { lanes_[i / 64] |= uint64_t(1) << (i % 64); }
+
+  uint64_t lane(int i) const { return lanes_[i]; }
+  uint64_t& lane(int i) { return lanes_[i]; }
+
+  BasicBits& operator&=(const BasicBits& other) {
+    for (int i = 0; i < kNumLanes; ++i) {
+      lanes_[i] &= other.lanes_[i];
+    }
+    return *this;
+  }
+  BasicBits& operator|=(const BasicBits& other) {
+    for (int i = 0; i < kNumLanes; ++i) {
+      lanes_[i] |= other.lanes_[i];
+    }
+    return *this;
+  }
+  BasicBits& operator^=(const BasicBits& other) {
+    for (int i = 0; i < kNumLanes; ++i) {
+      lanes_[i] ^= other.lanes_[i];
+    }
+    return *this;
+  }
+
+  friend BasicBits operator&(BasicBits a, const BasicBits& b) { return a &= b; }
+  friend BasicBits operator|(BasicBits a, const BasicBits& b) { return a |= b; }
+  friend BasicBits operator^(BasicBits a, const BasicBits& b) { return a ^= b; }
+  friend BasicBits operator~(BasicBits a) {
+    for (int i = 0; i < kNumLanes; ++i) {
+      a.lanes_[i] = ~a.lanes_[i];
+    }
+    return a;
+  }
+
+  // a & ~b, in one pass.
+  friend BasicBits AndNot(const BasicBits& a, const BasicBits& b) {
+    BasicBits result;
+    for (int i = 0; i < kNumLanes; ++i) {
+      result.lanes_[i] = a.lanes_[i] & ~b.lanes_[i];
+    }
+    return result;
+  }
+
+  // (a & ~mask) | (b & mask): bits of b where mask is set, else bits of a.
+  // This is how both the PRR and the IRR are composed.
+  friend BasicBits Select(const BasicBits& a, const BasicBits& b,
+                          const BasicBits& mask) {
+    BasicBits result;
+    for (int i = 0; i < kNumLanes; ++i) {
+      result.lanes_[i] = (a.lanes_[i] & ~mask.lanes_[i]) |
+                         (b.lanes_[i] & mask.lanes_[i]);
+    }
+    return result;
+  }
+
+  friend bool operator==(const BasicBits& a, const BasicBits& b) {
+    for (int i = 0; i < kNumLanes; ++i) {
+      if (a.lanes_[i] != b.lanes_[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+  friend bool operator!=(const BasicBits& a, const BasicBits& b) {
+    return !(a == b);
+  }
+
+  // Big-endian bytes of the low num_bytes * 8 bits: out[0] holds the most
+  // significant byte.  This is the layout of the std::vector<uint8_t> API.
+  void ToBytes(uint8_t* out, int num_bytes) const {
+    for (int i = 0; i < num_bytes; ++i) {
+      int byte = num_bytes - 1 - i;
+      out[i] = static_cast<uint8_t>(lanes_[byte / 8] >> (8 * (byte % 8)));
+    }
+  }
+  static BasicBits FromBytes(const uint8_t* in, int num_bytes) {
+    BasicBits result;
+    for (int i = 0; i < num_bytes; ++i) {
+      int byte = num_bytes - 1 - i;
+      result.lanes_[byte / 8] |= static_cast<uint64_t>(in[i]) << (8 * (byte % 8));
+    }
+    return result;
+  }
+
+ private:
+  alignas(kNumLanes >= 4 ? 32 : 8) uint64_t lanes_[kNumLanes];
+};
+
+typedef BasicBits<64> Bits64;
+typedef BasicBits<128> Bits128;
+typedef BasicBits<256> Bits256;
+
+}  // namespace rappor
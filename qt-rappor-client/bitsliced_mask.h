@@ -0,0 +1,67 @@
+// Bernoulli masks from uniform random words, shared by the IRR generators.
+//
+// Probabilities are quantized to a multiple of 1/128, and a 32-bit mask is
+// built from 7 random words with a bitsliced comparison instead of 32
+// separate draws.
+
+#pragma once
+
+#include "qt_rappor_global.h"
+
+#include <stdint.h>
+
+#include <cmath>
+
+#include "rappor_deps.h"
+
+namespace rappor {
+
+// Quantize a probability to a multiple of 1/128.
+inline uint32_t Threshold128(float prob) {
+  if (!(prob > 0.0f)) {
+    return 0;
+  }
+  if (prob >= 1.0f) {
+    return 128;
+  }
+  return static_cast<uint32_t>(std::lround(prob * 128));
+}
+
+// The low num_bits bits set, for masking the top word of a report.
+inline Bits LowBits(int num_bits) {
+  return num_bits >= 32 ? ~Bits(0) : (Bits(1) << num_bits) - 1;
+}
+
+// 32 Bernoulli bits with probability threshold/128, bitsliced: bit j of the
+// 7 random words forms a 7-bit uniform number u_j, and the mask bit is
+// u_j < threshold.  The comparison runs from the least significant bit up;
+// wherever u_j and threshold differ in bit i, that bit decides the result.
+//
+// next_word() returns a uniform 32-bit word.  It isn't called at all for a
+// threshold of 0 or 128.
+template <typename NextWord>
+inline Bits BitslicedMask(uint32_t threshold, NextWord&& next_word) {
+  if (threshold == 0) {
+    return 0;
+  }
+  if (threshold >= 128) {
+    return ~Bits(0);
+  }
+  Bits less = 0;
+  for (int i = 0; i < 7; ++i) {
+    Bits random = static_cast<Bits>(next_word());
+    if (threshold & (1u << i)) {
+      less |= ~random;
+    } else {
+      less &= ~random;
+    }
+  }
+  return less;
+}
+
+// The same, reading words[0..6].
+inline Bits BitslicedMaskFromWords(uint32_t threshold, const uint32_t* words) {
+  return BitslicedMask(threshold, [&words] { return *words++; });
+}
+
+}  // namespace rappor
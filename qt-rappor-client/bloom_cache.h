@@ -0,0 +1,79 @@
+// Memo of Bloom filters for rappor::Encoder.
+
+#pragma once
+
+#include "qt_rappor_global.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "rappor_deps.h"
+
+namespace rappor {
+
+// Everything besides the value that a Bloom filter depends on.
+struct BloomShape {
+  uint32_t cohort;
+  int num_bits;
+  int num_hashes;
+  uintptr_t hash_func;  // identity of the hash function
+
+  bool operator==(const BloomShape& other) const {
+    return cohort == other.cohort && num_bits == other.num_bits &&
+           num_hashes == other.num_hashes && hash_func == other.hash_func;
+  }
+};
+
+// A Bloom filter is a deterministic function of the value and its
+// BloomShape, so encoders can remember the filters of frequent values instead
+// of hashing them again.  One cache can be shared by any number of encoders;
+// entries are keyed by the full shape, so only encoders with the same cohort,
+// filter size and hash function hit each other's entries.
+//
+// The cache is a fixed-size, 2-way set-associative table indexed by a 64-bit
+// hash of the value, and every hit compares the full value.  Like PrrCache it
+// never blocks: a set that another thread holds is treated as a miss.
+class QT_RAPPOR_EXPORT BloomCache {
+ public:
+  // Holds up to max_entries values, rounded up to a power of two.
+  explicit BloomCache(size_t max_entries);
+  ~BloomCache();
+
+  // Returns true and sets bloom if value has been seen with this shape.
+  bool Lookup(std::string_view value, const BloomShape& shape, Bits* bloom);
+  void Insert(std::string_view value, const BloomShape& shape, Bits bloom);
+
+  size_t capacity() const { return num_sets_ * kWays; }
+  uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+  uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+ private:
+  static const size_t kWays = 2;
+
+  struct Way {
+    bool filled = false;
+    uint64_t hash = 0;
+    BloomShape shape = {};
+    Bits bloom = 0;
+    std::string value;
+  };
+  struct Set {
+    std::mutex mutex;
+    Way ways[kWays];
+    size_t next_victim = 0;
+  };
+
+  static uint64_t Hash(std::string_view value, const BloomShape& shape);
+
+  size_t num_sets_;
+  std::unique_ptr<Set[]> sets_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+};
+
+}  // namespace rappor
@@ -0,0 +1,35 @@
+// ChaCha20 keystream (RFC 8439).
+//
+// Used as the generator behind ChaChaRand.  On x86 whole groups of 4 or 8
+// blocks (256 or 512 bytes) are computed in parallel with SSE2 / AVX2,
+// selected at runtime; other targets and leftover blocks use the scalar block
+// function.
+
+#pragma once
+
+#include "qt_rappor_global.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace rappor {
+
+static const size_t kChaCha20KeySize = 32;
+static const size_t kChaCha20NonceSize = 12;
+static const size_t kChaCha20BlockSize = 64;
+
+// Writes num_blocks * kChaCha20BlockSize bytes of keystream for 'key' and
+// 'nonce', starting at block 'counter'.  The 32-bit block counter wraps.
+QT_RAPPOR_EXPORT void ChaCha20Keystream(const uint8_t* key,
+                                        const uint8_t* nonce,
+                                        uint32_t counter, size_t num_blocks,
+                                        uint8_t* out);
+
+// The portable implementation, for testing the vector kernels against.
+QT_RAPPOR_EXPORT void ChaCha20KeystreamScalar(const uint8_t* key,
+                                              const uint8_t* nonce,
+                                              uint32_t counter,
+                                              size_t num_blocks,
+                                              uint8_t* out);
+
+}  // namespace rappor
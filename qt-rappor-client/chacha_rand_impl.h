@@ -0,0 +1,53 @@
+#pragma once
+
+#include "qt-rappor-client/qt_rappor_global.h"
+
+#include "rappor_deps.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace rappor {
+
+// Cryptographically secure IRR randomness from a ChaCha20 keystream.
+//
+// Each refill computes 512 bytes of keystream; the first 32 bytes become the
+// next key (fast key erasure, so earlier output cannot be recovered from the
+// state) and the rest is handed out.  The key is reseeded from the OS
+// (getrandom() where available) on first use, every kReseedBytes, and in
+// the child after fork(), so parent and child never share output.
+//
+// Thread-safe: the default ChaChaRand keeps one generator per thread.  A
+// seeded ChaChaRand replays one sequence, never reseeds, and serializes its
+// callers.
+class QT_RAPPOR_EXPORT ChaChaRand : public IrrRandInterface
+{
+public:
+    static const uint64_t kReseedBytes = 1 << 20;
+
+    ChaChaRand();
+
+    // For unit testing
+    explicit ChaChaRand(uint64_t seed);
+
+    ~ChaChaRand() override;
+
+    // Probabilities are rounded to a multiple of 1/128, and each 32-bit
+    // mask costs 28 bytes of keystream (none for a probability of 0 or 1).
+    void GetMask(float prob, int num_bits, Bits* mask_out) const override;
+    void GetMasks(float prob_p, float prob_q, int num_bits,
+                  Bits* p_out, Bits* q_out) const override;
+
+private:
+    struct Generator;
+
+    template <typename Fn>
+    void WithGenerator(Fn fn) const;
+
+    // Only set for a seeded ChaChaRand.
+    std::unique_ptr<Generator> m_generator;
+    mutable std::mutex m_mutex;
+};
+
+}  // namespace rappor
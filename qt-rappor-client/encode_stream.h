@@ -0,0 +1,68 @@
+// Incremental encoding of long values.
+
+#pragma once
+
+#include "qt_rappor_global.h"
+
+#include <string>
+#include <string_view>
+
+#include "encoder.h"
+#include "md5.h"
+
+class QIODevice;
+
+namespace rappor {
+
+// EncodeStream encodes one string value that arrives in pieces, such as a
+// serialized config or a file, without holding all of it:
+//
+//   rappor::EncodeStream stream(&encoder);
+//   stream.Update(&file);  // or Update(chunk) repeatedly
+//   stream.Finish(&irr);
+//
+// The report is the same as encoder.EncodeString() of the concatenated
+// chunks.  With the built-in Md5 hash function, the cohort and the chunks go
+// straight into an incremental MD5, so memory use doesn't depend on the
+// value size.  Other hash functions only take whole values, so the stream
+// then buffers the value.
+class QT_RAPPOR_EXPORT EncodeStream {
+ public:
+  // encoder is held by pointer and must outlive the stream.  The stream
+  // starts on a new value.
+  explicit EncodeStream(const Encoder* encoder);
+
+  // Discard any input and start a new value.  Finish() does this too.
+  void BeginValue();
+
+  void Update(std::string_view chunk);
+  // Reads a random-access device (a file or a QBuffer) until its end.
+  // Returns false on a read error, after which the value is incomplete.
+  // Sequential devices (sockets, pipes, QProcess) are rejected without
+  // reading: their end of input can't be told from a pause, so feed their
+  // data through Update(chunk) instead.
+  bool Update(QIODevice* device);
+
+  // Encode the value and start a new one.  Returns false on failure.
+  bool Finish(Bits* irr_out);
+  // Reports wider than 32 bits; see Encoder::EncodeString().
+  template <int N>
+  bool Finish(BasicBits<N>* irr_out);
+
+  // For testing/simulation use only.
+  bool _FinishInternal(Bits* bloom_out, Bits* prr_out, Bits* irr_out);
+  template <int N>
+  bool _FinishInternal(BasicBits<N>* bloom_out, BasicBits<N>* prr_out,
+                       BasicBits<N>* irr_out);
+
+ private:
+  // Finishes the Bloom hash of the value.
+  bool FinishHash(uint8_t* hash_output, size_t* hash_size);
+
+  const Encoder* encoder_;
+  const bool incremental_;  // encoder_ hashes with MD5
+  Md5Context md5_;
+  std::string value_;  // the whole value, when not incremental
+};
+
+}  // namespace rappor
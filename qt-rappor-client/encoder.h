@@ -21,9 +21,28 @@
 
 #include "qt_rappor_global.h"
 
+#include <memory>
 #include <string>
+#include <string_view>
 
+#include <QByteArray>
+#include <QStringView>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <QByteArrayView>
+#endif
+
+#include "bits.h"
 #include "rappor_deps.h"  // for dependency injection
+#include "sha256.h"
+
+namespace rappor {
+class BloomCache;
+struct BloomShape;
+class EncodeStream;
+class EncoderRegistry;
+class EnumEncoder;
+class PrrCache;
+}
 
 namespace rappor {
 
@@ -44,12 +63,12 @@ class QT_RAPPOR_EXPORT Params {
   }
 
   // Accessors
-  int num_bits() { return num_bits_; }
-  int num_hashes() { return num_hashes_; }
-  int num_cohorts() { return num_cohorts_; }
-  float prob_f() { return prob_f_; }
-  float prob_p() { return prob_p_; }
-  float prob_q() { return prob_q_; }
+  int num_bits() const { return num_bits_; }
+  int num_hashes() const { return num_hashes_; }
+  int num_cohorts() const { return num_cohorts_; }
+  float prob_f() const { return prob_f_; }
+  float prob_p() const { return prob_p_; }
+  float prob_q() const { return prob_q_; }
 
  private:
   friend class Encoder;
@@ -71,8 +90,17 @@ class QT_RAPPOR_EXPORT Params {
   float prob_q_;  // noise probability for IRR, quantized to 1/128
 };
 
+template <typename P>
+class StaticEncoder;
+
 // Encoder: take client values and transform them with the RAPPOR privacy
 // algorithm.
+//
+// The const Encode*() methods may be called concurrently from any number of
+// threads, without locking, provided the Deps functions and IrrRandInterface
+// are thread-safe themselves (the ones in this library are).
+// set_cohort(), set_prr_cache_size() and set_bloom_cache() must not race with
+// encoding.
 class QT_RAPPOR_EXPORT Encoder {
  public:
   // Note that invalid parameters cause runtime assertions in the constructor.
@@ -95,36 +123,183 @@ class QT_RAPPOR_EXPORT Encoder {
 
   // Encode a string, setting output parameter irr_out.  Only valid when the
   // return value is 'true' (success).
-  bool EncodeString(const std::string& value, Bits* irr_out) const;
+  bool EncodeString(std::string_view value, Bits* irr_out) const;
   // For use with HmacDrbg hash function and any num_bits divisible by 8.
-  bool EncodeString(const std::string& value,
+  bool EncodeString(std::string_view value,
                     std::vector<uint8_t>* irr_out) const;
 
+  // Qt strings, encoded as UTF-8 (like QString::toUtf8()) into a per-thread
+  // buffer rather than a temporary std::string.
+  bool EncodeString(QStringView value, Bits* irr_out) const;
+  // Values that are already UTF-8 (or arbitrary bytes), hashed in place.
+  bool EncodeUtf8(const QByteArray& value, Bits* irr_out) const;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+  bool EncodeUtf8(QByteArrayView value, Bits* irr_out) const;
+#endif
+
+  // Fixed-width reports for num_bits > 32, for use with HmacDrbg.  num_bits
+  // must be at most N; higher bits of the report are zero.  Available for N =
+  // 64, 128, 256, 512 and 1024.  The report has the same bits as the
+  // byte-vector EncodeString(), without the byte-at-a-time work.
+  template <int N>
+  bool EncodeBits(const BasicBits<N>& bits, BasicBits<N>* irr_out) const;
+  template <int N>
+  bool EncodeString(std::string_view value, BasicBits<N>* irr_out) const;
+
+  // Batch variants: encode 'count' values back to back, writing one IRR per
+  // value into irr_out[0..count).  Returns false if any value fails to
+  // encode; irr_out is then only partially set.
+  bool EncodeStrings(const std::string* values, size_t count,
+                     Bits* irr_out) const;
+  bool EncodeStrings(const std::string_view* values, size_t count,
+                     Bits* irr_out) const;
+  bool EncodeBitsBatch(const Bits* bits, size_t count, Bits* irr_out) const;
+
+  // Fan-out: encode one value for each of 'count' encoders (typically
+  // different metrics), writing one IRR per encoder into irr_out[0..count).
+  // The Bloom filter is computed once for all encoders that share a cohort,
+  // num_bits, num_hashes and hash function.  Returns false if any encoder
+  // fails; irr_out is then only partially set.
+  static bool EncodeStringFanOut(std::string_view value,
+                                 const Encoder* const* encoders, size_t count,
+                                 Bits* irr_out);
+
   // For testing/simulation use only.
   bool _EncodeBitsInternal(const Bits bits, Bits* prr_out, Bits* irr_out)
     const;
-  bool _EncodeStringInternal(const std::string& value, Bits* bloom_out,
+  bool _EncodeStringInternal(std::string_view value, Bits* bloom_out,
                              Bits* prr_out, Bits* irr_out) const;
+  // bloom_out and prr_out may be null if not needed.
+  bool _EncodeStringsInternal(const std::string* values, size_t count,
+                              Bits* bloom_out, Bits* prr_out,
+                              Bits* irr_out) const;
+  bool _EncodeStringsInternal(const std::string_view* values, size_t count,
+                              Bits* bloom_out, Bits* prr_out,
+                              Bits* irr_out) const;
+  bool _EncodeBitsBatchInternal(const Bits* bits, size_t count,
+                                Bits* prr_out, Bits* irr_out) const;
+  template <int N>
+  bool _EncodeBitsInternal(const BasicBits<N>& bits, BasicBits<N>* prr_out,
+                           BasicBits<N>* irr_out) const;
+  template <int N>
+  bool _EncodeStringInternal(std::string_view value, BasicBits<N>* bloom_out,
+                             BasicBits<N>* prr_out,
+                             BasicBits<N>* irr_out) const;
 
   // Accessor for the assigned cohort.
-  uint32_t cohort() { return cohort_; }
+  uint32_t cohort() const { return cohort_; }
   // Set a cohort manually, if previously generated.
   void set_cohort(uint32_t cohort);
 
+  // Remember the PRR masks of up to max_entries distinct inputs, so that
+  // re-encoding a value skips the HMAC.  When all 2^num_bits inputs fit, a
+  // dense table is used instead of an LRU.  0 disables the cache (default).
+  // Only used for num_bits <= 32; the byte-vector EncodeString() ignores it.
+  void set_prr_cache_size(size_t max_entries);
+
+  // Remember the Bloom filters of recently encoded strings in 'cache', which
+  // may be shared with other encoders.  Null disables it (default).  Only
+  // used for num_bits <= 32.
+  void set_bloom_cache(std::shared_ptr<BloomCache> cache);
+
  private:
-  bool MakeBloomFilter(const std::string& value, Bits* bloom_out) const;
-  bool MakeBloomFilter(const std::string& value,
-                       std::vector<uint8_t>* bloom_out) const;
+  template <typename P>
+  friend class StaticEncoder;
+
+  // Hash cohort_str_ + value for the Bloom filter, writing up to 64 bytes.
+  bool BloomHash(std::string_view value, uint8_t* hash_output,
+                 size_t* hash_size) const;
+  // Write output_size bytes of HMAC(client_secret_, hmac_value).
+  bool PrrHmac(const std::string& hmac_value, uint8_t* output,
+               size_t output_size) const;
+  // The 32-byte PRR HMAC for raw bits.
+  bool PrrDigest(const Bits bits, uint8_t* sha256) const;
+
+  // What MakeBloomFilter() depends on besides the value.
+  BloomShape bloom_shape() const;
+  bool MakeBloomFilter(std::string_view value, Bits* bloom_out) const;
+  // The Bloom filter for a BloomHash() output.
+  bool BloomFromHash(const uint8_t* hash_output, size_t hash_size,
+                     Bits* bloom_out) const;
   bool GetPrrMasks(const Bits bits, Bits* uniform, Bits* f_mask) const;
+  void GetIrrMasks(Bits* p_bits, Bits* q_bits) const;
+
+  template <int N>
+  bool MakeBloomFilter(std::string_view value, BasicBits<N>* bloom_out) const;
+  template <int N>
+  bool BloomFromHash(const uint8_t* hash_output, size_t hash_size,
+                     BasicBits<N>* bloom_out) const;
+  template <int N>
+  bool GetPrrMasks(const BasicBits<N>& bits, BasicBits<N>* uniform,
+                   BasicBits<N>* f_mask) const;
+  template <int N>
+  void GetIrrMasks(BasicBits<N>* p_bits, BasicBits<N>* q_bits) const;
+
+  // Bloom filters for count <= 16 values.  With the built-in MD5 and no
+  // Bloom cache the hashes are computed together by Md5Batch().
+  template <typename String>
+  bool MakeBloomFilters(const String* values, size_t count,
+                        Bits* blooms_out) const;
+  template <typename String>
+  bool EncodeStringsImpl(const String* values, size_t count, Bits* bloom_out,
+                         Bits* prr_out, Bits* irr_out) const;
+
+  friend class EncodeStream;
+  friend class EncoderRegistry;
+  friend class EnumEncoder;
+
+  // For EncoderRegistry: refer to the registry's interned encoder_id, deps
+  // and keyed PRR HMAC state, and take its cohort hash, instead of copying
+  // or computing them again.  All of them must outlive the encoder.
+  Encoder(std::string_view encoder_id, const Params& params,
+          const Deps& deps, uint32_t cohort_hash,
+          const HmacSha256Context* keyed_hmac);
+
+  // Logging through rapporLog, which is internal to the library, for
+  // StaticEncoder code compiled into the application.
+  static void LogDebug(const char* message, const char* detail = "");
+  static void LogWarning(const char* message, const char* detail = "");
+
+  // Runtime assertions on params, for the constructors and
+  // EncoderRegistry::Register().
+  static void CheckParams(const Params& params, const Deps& deps);
+  // Shared part of the constructors: validation and hash setup.  keyed_hmac
+  // must be set if the PRR uses HmacSha256.
+  void Init(const HmacSha256Context* keyed_hmac);
+  static bool UsesHmacSha256(const Deps& deps);
+
+  // The client state of an encoder made by the public constructor: its
+  // encoder_id, a copy of deps and, for HmacSha256, the keyed HMAC state.
+  // Shared by copies of the encoder.
+  struct ClientState;
+  static std::shared_ptr<const ClientState> MakeClientState(
+      const std::string& encoder_id, const Deps& deps);
 
-  // static helper function for initialization
+  // static helper functions for initialization.  The cohort is the low bits
+  // of CohortHash(), which depends only on the client secret.
+  static uint32_t CohortHash(const Deps& deps);
   static uint32_t AssignCohort(const Deps& deps, int num_cohorts);
 
-  const std::string encoder_id_;
+  // Null for encoders built by an EncoderRegistry, whose encoder_id_, deps_
+  // and prr_key_ point into the registry instead.
+  std::shared_ptr<const ClientState> own_state_;
+  std::string_view encoder_id_;
   Params params_;
-  Deps deps_;
+  const Deps* deps_;
   uint32_t cohort_;
   std::string cohort_str_;
+  // Allocation-free hash functions: from deps_, or our own equivalents of
+  // deps_->hash_func_ / deps_->hmac_func_.  Null if there are none.
+  HashIntoFunc* hash_into_;
+  HmacIntoFunc* hmac_into_;
+  // When hmac_into_ is HmacSha256Into: the HMAC state keyed with the client
+  // secret, and its inner hash after kHmacPrrPrefix + encoder_id_.  Null key
+  // for other HMAC functions.
+  const HmacSha256Context* prr_key_;
+  Sha256Context prr_inner_;
+  // Shared by copies of this encoder, which have the same PRR.
+  std::shared_ptr<PrrCache> prr_cache_;
+  std::shared_ptr<BloomCache> bloom_cache_;
 };
 
 }  // namespace rappor
@@ -0,0 +1,80 @@
+// Many metric encoders sharing one client's state.
+
+#pragma once
+
+#include "qt_rappor_global.h"
+
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "encoder.h"
+#include "sha256.h"
+
+namespace rappor {
+
+// EncoderRegistry holds the encoders for all metrics of one client.
+//
+// The cohort HMAC and the keyed PRR HMAC state depend only on the client
+// secret, so they are computed once here instead of in every Encoder.  Metric
+// names are copied into an arena, and each metric is one entry in a flat
+// table, found by name with a hash lookup.  The Encoder for a metric is only
+// built the first time it is asked for, and refers to the registry's name,
+// deps and keyed HMAC state rather than holding copies.
+//
+// Register() all metrics first, typically at startup.  After that, Find() and
+// Get() may be called from any number of threads.
+class QT_RAPPOR_EXPORT EncoderRegistry {
+ public:
+  // deps is copied.
+  explicit EncoderRegistry(const Deps& deps);
+  ~EncoderRegistry();
+
+  EncoderRegistry(const EncoderRegistry&) = delete;
+  EncoderRegistry& operator=(const EncoderRegistry&) = delete;
+
+  // Registers a metric and returns its handle.  Registering a name again
+  // returns the existing handle.  Invalid params cause runtime assertions
+  // here, as in the Encoder constructor.
+  int Register(std::string_view encoder_id, const Params& params);
+
+  // Returns the handle of a registered metric, or -1.
+  int Find(std::string_view encoder_id) const;
+
+  // Returns the encoder for a handle or name, building it on first use, or
+  // null if there is no such metric.  The encoder, and any copy of it, must
+  // not outlive the registry.
+  const Encoder* Get(int handle) const;
+  const Encoder* Get(std::string_view encoder_id) const;
+
+  // Number of registered metrics, and how many of them have been built.
+  size_t size() const { return entries_.size(); }
+  size_t built() const;
+
+ private:
+  struct Entry {
+    Entry(std::string_view id, const Params& params);
+    Entry(Entry&& other) noexcept;  // only while registering
+    ~Entry();
+
+    std::string_view id;  // points into the name arena
+    Params params;
+    mutable std::atomic<Encoder*> encoder;
+  };
+
+  std::string_view Intern(std::string_view name);
+
+  const Deps deps_;
+  const uint32_t cohort_hash_;
+  const HmacSha256Context keyed_hmac_;
+
+  std::vector<std::unique_ptr<char[]>> name_blocks_;
+  size_t name_block_used_;
+
+  std::vector<Entry> entries_;
+  std::unordered_map<std::string_view, int> index_;
+};
+
+}  // namespace rappor
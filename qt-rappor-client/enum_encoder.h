@@ -0,0 +1,71 @@
+// Encoder for values from a small, fixed domain.
+
+#pragma once
+
+#include "qt_rappor_global.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "encoder.h"
+
+namespace rappor {
+
+// EnumEncoder precomputes the PRR of every member of a fixed domain (error
+// codes, feature flags, buckets, ...), so that encoding a member is a table
+// lookup plus the IRR.  Reports are identical to Encoder::EncodeString() for
+// the same member.
+//
+// In kOneHot mode the encoder reports basic RAPPOR instead: member i sets bit
+// i, with no Bloom filter.  The domain must then fit in num_bits.
+//
+// The tables are built for the encoder's cohort at construction; don't
+// set_cohort() afterwards.  Like Encoder, the Encode*() methods may be called
+// concurrently.
+class QT_RAPPOR_EXPORT EnumEncoder {
+ public:
+  enum Mode {
+    kBloom,
+    kOneHot,
+  };
+
+  // encoder is held by pointer and must outlive the EnumEncoder.  An invalid
+  // domain (too large for kOneHot, duplicate members) or a hash failure
+  // causes a runtime assertion, as with Encoder.
+  EnumEncoder(const Encoder* encoder, const std::vector<std::string>& domain,
+              Mode mode = kBloom);
+  // Copies rebuild the member index over their own copy of the domain.
+  // Moving keeps the domain strings in place, so the index stays valid.
+  EnumEncoder(const EnumEncoder& other);
+  EnumEncoder& operator=(const EnumEncoder& other);
+  EnumEncoder(EnumEncoder&& other) = default;
+  EnumEncoder& operator=(EnumEncoder&& other) = default;
+
+  // Encode the member at 'index' in the domain.  Returns false if index is
+  // out of range or the IRR fails.
+  bool EncodeIndex(size_t index, Bits* irr_out) const;
+  // Encode a member by value.  Returns false if it is not in the domain.
+  bool EncodeString(std::string_view value, Bits* irr_out) const;
+
+  // Index of a member, or -1.
+  int IndexOf(std::string_view value) const;
+  size_t size() const { return prr_.size(); }
+
+  // For testing/simulation use only.
+  bool _EncodeIndexInternal(size_t index, Bits* bloom_out, Bits* prr_out,
+                            Bits* irr_out) const;
+
+ private:
+  // Fills index_ from domain_.
+  void BuildIndex();
+
+  const Encoder* encoder_;
+  std::vector<Bits> bloom_;  // Bloom filter (or one-hot bit) per member
+  std::vector<Bits> prr_;    // PRR per member
+  std::vector<std::string> domain_;
+  std::unordered_map<std::string_view, int> index_;  // views into domain_
+};
+
+}  // namespace rappor
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "qt-rappor-client/qt_rappor_global.h"
+
+#include "rappor_deps.h"
+
+#include <cstddef>
+
+namespace rappor {
+
+// IRR randomness read straight from the kernel.
+//
+// Each thread keeps a kBufferBytes buffer filled from getrandom() (or
+// /dev/urandom where that is unavailable), so one syscall covers a few
+// thousand 32-bit masks.  The buffer is discarded in the child after fork(),
+// so parent and child never hand out the same bytes.  Aborts with qFatal()
+// if the kernel provides no randomness at all.
+class QT_RAPPOR_EXPORT KernelRand : public IrrRandInterface
+{
+public:
+    static const size_t kBufferBytes = 64 * 1024;
+
+    KernelRand();
+
+    // Probabilities are rounded to a multiple of 1/128, and each 32-bit
+    // mask costs 28 random bytes (none for a probability of 0 or 1).
+    void GetMask(float prob, int num_bits, Bits* mask_out) const override;
+    void GetMasks(float prob_p, float prob_q, int num_bits,
+                  Bits* p_out, Bits* q_out) const override;
+};
+
+}  // namespace rappor
@@ -0,0 +1,52 @@
+// MD5 writing into caller storage.
+//
+// QCryptographicHash returns its digest in a heap-allocated QByteArray; the
+// encoder hashes one short value per report, so it uses this instead.  The
+// compression function is fully unrolled, and Md5CompressLanes() runs many
+// independent messages through it in SIMD lanes.
+
+#pragma once
+
+#include "qt_rappor_global.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace rappor {
+
+QT_RAPPOR_EXPORT extern const uint32_t kMd5InitialState[4];
+
+// Compresses num_blocks consecutive 64-byte blocks into the 4-word state.
+QT_RAPPOR_EXPORT void Md5Compress(uint32_t* state, const uint8_t* blocks,
+                                  size_t num_blocks);
+
+// Multi-buffer compression of independent messages: compresses blocks[i]
+// into the state at states + 4 * i, for i < num_lanes.  On x86 groups of 16
+// (AVX-512), 8 (AVX2) and 4 (SSE2) lanes run in parallel; the rest go
+// through Md5Compress() one at a time.
+QT_RAPPOR_EXPORT void Md5CompressLanes(uint32_t* states,
+                                       const uint8_t* const* blocks,
+                                       size_t num_lanes);
+
+class QT_RAPPOR_EXPORT Md5Context {
+ public:
+  static const size_t kBlockSize = 64;
+  static const size_t kDigestSize = 16;
+
+  Md5Context();
+
+  // One-shot digest of [data, data + len) into kDigestSize bytes.
+  static void Hash(const void* data, size_t len, uint8_t* digest);
+
+  void Update(const void* data, size_t len);
+  // Writes kDigestSize bytes.  The object must not be updated afterwards.
+  void Final(uint8_t* digest);
+
+ private:
+  uint32_t state_[4];
+  uint64_t length_;  // total bytes absorbed
+  uint8_t buffer_[kBlockSize];
+  size_t buffered_;
+};
+
+}  // namespace rappor
@@ -0,0 +1,31 @@
+// Randomness from the operating system, and fork() detection, for the IRR
+// generators that seed or refill from it.
+
+#pragma once
+
+#include "qt_rappor_global.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace rappor {
+
+// Fills [out, out + len) from the kernel: getrandom() where available, then
+// /dev/urandom, retrying on EINTR and short reads.  Platforms with neither
+// use std::random_device.  Returns the number of bytes at the end of the
+// range it could not fill.
+QT_RAPPOR_EXPORT size_t KernelRandom(uint8_t* out, size_t len);
+
+// KernelRandom(), falling back to std::random_device for anything it could
+// not fill.
+QT_RAPPOR_EXPORT void OsRandom(uint8_t* out, size_t len);
+
+// Installs (once per process) a handler that bumps ForkGeneration() in the
+// child after every fork().  Generators that keep state derived from OS
+// randomness call it before first use, record ForkGeneration() when they
+// seed, and reseed when it has changed, so a parent and child never share
+// output.  Without pthread_atfork() the generation never changes.
+QT_RAPPOR_EXPORT void RegisterForkHandler();
+QT_RAPPOR_EXPORT uint32_t ForkGeneration();
+
+}  // namespace rappor
@@ -0,0 +1,29 @@
+// Philox4x32-10 counter-based generator (Salmon et al., "Parallel Random
+// Numbers: As Easy as 1, 2, 3").
+//
+// Output is a pure function of (key, counter), which lets PhiloxRand give
+// every report its own reproducible stream.  On x86 groups of 8 blocks are
+// computed in parallel with AVX2, selected at runtime; other targets and
+// leftover blocks use the scalar rounds.
+
+#pragma once
+
+#include "qt_rappor_global.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace rappor {
+
+// Writes num_blocks * 4 words: block i is Philox4x32-10 of 'key' and the
+// counter {counter[0] + i, counter[1], counter[2], counter[3]} (the first
+// word wraps).
+QT_RAPPOR_EXPORT void Philox4x32(const uint32_t* key, const uint32_t* counter,
+                                 size_t num_blocks, uint32_t* out);
+
+// The portable implementation, for testing the vector kernel against.
+QT_RAPPOR_EXPORT void Philox4x32Scalar(const uint32_t* key,
+                                       const uint32_t* counter,
+                                       size_t num_blocks, uint32_t* out);
+
+}  // namespace rappor
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "qt-rappor-client/qt_rappor_global.h"
+
+#include "rappor_deps.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+namespace rappor {
+
+// Reproducible IRR randomness for simulations.  Not for production clients:
+// anyone who knows the seed can remove the IRR noise.
+//
+// The masks are a pure function of (seed, client id, report index) and of
+// the sequence of calls made on this object: call n always sees Philox4x32
+// blocks [8n, 8n + 8) of its stream (more for masks wider than 64 bits).
+// Rows of a simulation can therefore be encoded on any thread, in any order,
+// with bit-identical output.  Create one PhiloxRand per report.
+class QT_RAPPOR_EXPORT PhiloxRand : public IrrRandInterface
+{
+public:
+    PhiloxRand(uint64_t seed, uint64_t client_id, uint32_t report_index);
+
+    // A stable 64-bit id (FNV-1a) for a client name.
+    static uint64_t ClientId(std::string_view client);
+
+    // Probabilities are rounded to a multiple of 1/128.  Each call consumes
+    // 8 blocks per 64 bits of mask.
+    void GetMask(float prob, int num_bits, Bits* mask_out) const override;
+    void GetMasks(float prob_p, float prob_q, int num_bits,
+                  Bits* p_out, Bits* q_out) const override;
+
+private:
+    uint32_t m_key[2];
+    // Counter words 1-3: the report index and client id.  Word 0, the block
+    // index, comes from m_nextBlock.
+    uint32_t m_stream[3];
+    mutable std::atomic<uint32_t> m_nextBlock{0};
+};
+
+}  // namespace rappor
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "qt-rappor-client/qt_rappor_global.h"
+
+#include "rappor_deps.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace rappor {
+
+// IRR randomness generated ahead of time by a background thread.
+//
+// PrefetchRand wraps another IrrRandInterface (the source).  For each
+// (prob_p, prob_q, num_bits) that GetMasks() is called with, it keeps a
+// lock-free ring of p/q mask pairs, which a background thread fills from the
+// source.  Encoding then only pops a ready pair.  When a ring is empty,
+// GetMasks() draws from the source on the calling thread instead.
+//
+// Rings are created on first use, for up to kMaxStreams parameter sets and
+// num_bits <= kMaxBits; other calls, and GetMask(), go straight to the
+// source.  The source must be thread-safe.
+class QT_RAPPOR_EXPORT PrefetchRand : public IrrRandInterface
+{
+public:
+    static const int kMaxStreams = 8;
+    static const int kMaxBits = 64;
+
+    struct Stats {
+        uint64_t refilled;    // pairs generated by the background thread
+        uint64_t prefetched;  // GetMasks() calls served from a ring
+        uint64_t underflows;  // GetMasks() calls that found a ring empty
+        size_t occupancy;     // pairs ready, over all rings
+        size_t capacity;      // ring size, over all rings
+    };
+
+    // Each ring holds 'capacity' pairs, rounded up to a power of two.
+    explicit PrefetchRand(std::shared_ptr<IrrRandInterface> source,
+                          size_t capacity = 256);
+    ~PrefetchRand() override;
+
+    void GetMask(float prob, int num_bits, Bits* mask_out) const override;
+    void GetMasks(float prob_p, float prob_q, int num_bits,
+                  Bits* p_out, Bits* q_out) const override;
+
+    Stats stats() const;
+
+private:
+    static const int kMaxWords = kMaxBits / 32;
+
+    // Bounded multi-producer multi-consumer queue (Vyukov).
+    struct Cell {
+        std::atomic<size_t> sequence;
+        Bits p[kMaxWords];
+        Bits q[kMaxWords];
+    };
+    struct Stream {
+        enum State { kEmpty, kInitializing, kReady };
+        std::atomic<int> state{kEmpty};
+        float prob_p = 0;
+        float prob_q = 0;
+        int num_bits = 0;
+        std::unique_ptr<Cell[]> cells;
+        alignas(64) std::atomic<size_t> enqueue_pos{0};
+        alignas(64) std::atomic<size_t> dequeue_pos{0};
+    };
+
+    Stream* FindStream(float prob_p, float prob_q, int num_bits) const;
+    bool Pop(Stream& stream, Bits* p_out, Bits* q_out) const;
+    bool Push(Stream& stream);
+    size_t Occupancy(const Stream& stream) const;
+    void RequestRefill() const;
+    void RefillLoop();
+
+    const std::shared_ptr<IrrRandInterface> m_source;
+    const size_t m_capacity;
+    mutable Stream m_streams[kMaxStreams];
+
+    mutable std::atomic<uint64_t> m_refilled{0};
+    mutable std::atomic<uint64_t> m_prefetched{0};
+    mutable std::atomic<uint64_t> m_underflows{0};
+
+    mutable std::atomic<bool> m_refillRequested{false};
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_wakeup;
+    bool m_stop = false;
+    std::thread m_thread;
+};
+
+}  // namespace rappor
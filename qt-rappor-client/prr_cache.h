@@ -0,0 +1,80 @@
+// Memo of PRR masks for rappor::Encoder.
+
+#pragma once
+
+#include "qt_rappor_global.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "rappor_deps.h"
+
+namespace rappor {
+
+// The PRR masks are a deterministic function of (client_secret, encoder_id,
+// bits), so an encoder can remember them instead of recomputing the HMAC for
+// values it has already reported.
+//
+// If all 2^num_bits inputs fit in max_entries, the cache is a dense table with
+// one slot per input, filled lazily.  Otherwise it is an LRU holding at most
+// max_entries inputs.  Both are allocated up front, so Lookup() and Insert()
+// never allocate: the LRU is an intrusive list over a fixed array of nodes,
+// indexed by an open-addressing hash table.
+//
+// Lookup() and Insert() are safe to call concurrently and never block.
+// Dense slots are atomics; the LRU is skipped (a miss, or a dropped insert)
+// when another thread holds its lock.
+class QT_RAPPOR_EXPORT PrrCache {
+ public:
+  PrrCache(int num_bits, size_t max_entries);
+
+  // Returns true and sets the masks if 'bits' has been seen before.
+  bool Lookup(Bits bits, Bits* uniform, Bits* f_mask);
+  void Insert(Bits bits, Bits uniform, Bits f_mask);
+
+  bool dense() const { return dense_size_ != 0; }
+  size_t size() const;
+
+ private:
+  // uniform in the high word, f_mask in the low word.  The top bit marks a
+  // filled dense slot; it is free since dense tables have num_bits < 32.
+  static const uint64_t kFilled = 1ULL << 63;
+  static uint64_t Pack(Bits uniform, Bits f_mask) {
+    return (static_cast<uint64_t>(uniform) << 32) | f_mask;
+  }
+
+  static const uint32_t kNone = UINT32_MAX;
+  static const size_t kNoSlot = SIZE_MAX;
+
+  struct Node {
+    Bits bits;
+    uint64_t entry;  // Pack()ed masks
+    uint32_t prev;   // towards the most recently used, or kNone
+    uint32_t next;   // towards the least recently used, or kNone
+  };
+
+  // LRU helpers; the caller holds mutex_.
+  size_t Home(Bits bits) const;
+  size_t FindSlot(Bits bits) const;  // slot of bits' node, or kNoSlot
+  void EraseSlot(size_t slot);
+  void Unlink(uint32_t node);
+  void PushFront(uint32_t node);
+
+  const size_t max_entries_;
+  mutable std::mutex mutex_;
+
+  std::unique_ptr<std::atomic<uint64_t>[]> dense_;
+  size_t dense_size_;
+
+  std::unique_ptr<Node[]> nodes_;  // max_entries_ of them
+  size_t lru_size_;                // nodes in use
+  uint32_t head_;                  // most recently used
+  uint32_t tail_;                  // least recently used
+  std::unique_ptr<uint32_t[]> slots_;  // node index + 1, or 0 if empty
+  size_t slot_mask_;                   // slot count - 1, a power of two
+};
+
+}  // namespace rappor
@@ -0,0 +1,30 @@
+// PRR mask extraction from HMAC output.
+//
+// Each PRR bit consumes one byte of HMAC output: its low bit is the uniform
+// bit, and its upper 7 bits are compared against prob_f * 128 for the f_mask.
+// On x86 the bytes are processed 16 or 32 at a time with SSE2 / AVX2,
+// selected at runtime; other targets use the scalar loop.
+
+#pragma once
+
+#include "qt_rappor_global.h"
+
+#include <stdint.h>
+
+namespace rappor {
+
+// Sets bit i of uniform_out / f_mask_out from bytes[i], for i < num_bits, in
+// (num_bits + 63) / 64 words, least significant word first.  Bits above
+// num_bits are cleared.
+QT_RAPPOR_EXPORT void ExtractPrrMasks(const uint8_t* bytes, int num_bits,
+                                      uint8_t threshold128,
+                                      uint64_t* uniform_out,
+                                      uint64_t* f_mask_out);
+
+// The portable implementation, for testing the vector kernels against.
+QT_RAPPOR_EXPORT void ExtractPrrMasksScalar(const uint8_t* bytes, int num_bits,
+                                            uint8_t threshold128,
+                                            uint64_t* uniform_out,
+                                            uint64_t* f_mask_out);
+
+}  // namespace rappor
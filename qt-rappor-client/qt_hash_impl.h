@@ -29,5 +29,34 @@ bool QT_RAPPOR_EXPORT HmacDrbg(const std::string& key, const std::string& value,
               std::vector<uint8_t>* output);
 bool QT_RAPPOR_EXPORT Md5(const std::string& value, std::vector<uint8_t>* output);
 
+// Allocation-free versions of the above.  HmacDrbgInto writes output_size
+// bytes.
+bool QT_RAPPOR_EXPORT HmacSha256Into(std::string_view key,
+                                     std::string_view value,
+                                     HmacDigest* output);
+bool QT_RAPPOR_EXPORT HmacDrbgInto(std::string_view key, std::string_view value,
+                                   uint8_t* output, size_t output_size);
+bool QT_RAPPOR_EXPORT Md5Into(std::string_view value, HashDigest* output);
+
+// HMAC-SHA256 of 'count' independent (keys[i], values[i]) pairs into
+// outputs[i].  Up to 16 messages at a time are padded and hashed in
+// lock-step through the multi-buffer SHA-256 kernels (AVX-512 / AVX2), so
+// batches of short messages cost far less than one HmacSha256Into() each.
+//
+// Encoder doesn't use it for PRRs: they all share the client secret and a
+// per-encoder prefix, so each is finished from a precomputed midstate
+// (HmacSha256Context) in two compressions, while a batch starts every
+// message from the key and needs four.  The batch helps callers with many
+// keys, or on CPUs with AVX2 but no SHA-NI.
+bool QT_RAPPOR_EXPORT HmacSha256Batch(const std::string_view* keys,
+                                      const std::string_view* values,
+                                      size_t count, HmacDigest* outputs);
+
+// MD5 of 'count' independent values into outputs[i], up to 16 at a time
+// through the multi-buffer MD5 kernels (AVX-512 / AVX2 / SSE2).  Same
+// digests as Md5Into().
+bool QT_RAPPOR_EXPORT Md5Batch(const std::string_view* values, size_t count,
+                               HashDigest* outputs);
+
 }  // namespace rappor
 
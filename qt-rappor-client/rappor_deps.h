@@ -21,7 +21,9 @@
 #include "qt-rappor-client/qt_rappor_global.h"
 
 #include <stdint.h>  // for uint32_t
+#include <array>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 
@@ -37,6 +39,16 @@ typedef bool HashFunc(const std::string& value, std::vector<uint8_t>* output);
 typedef bool HmacFunc(const std::string& key, const std::string& value,
                       std::vector<uint8_t>* output);
 
+// Allocation-free variants, writing a fixed-size digest into caller storage
+// (MD5 and HMAC-SHA256 sized, respectively).  With these the encoder does no
+// heap allocation per report.
+typedef std::array<uint8_t, 16> HashDigest;
+typedef std::array<uint8_t, 32> HmacDigest;
+
+typedef bool HashIntoFunc(std::string_view value, HashDigest* output);
+typedef bool HmacIntoFunc(std::string_view key, std::string_view value,
+                          HmacDigest* output);
+
 // Interface that the encoder use to generate randomness for the IRR.
 // Applications should implement this based on their platform and requirements.
 class IrrRandInterface {
@@ -45,6 +57,19 @@ class IrrRandInterface {
   // Compute a bitmask with each bit set to 1 with probability 'prob'.
   // Returns false if there is an error.
   virtual void GetMask(float prob, int num_bits, Bits* mask_out) const = 0;
+
+  // Compute both IRR masks for a report of num_bits bits in one call:
+  // (num_bits + 31) / 32 words each, least significant word first, with bits
+  // above num_bits cleared.  The default calls GetMask() once per word;
+  // implementations that can draw masks in bulk should override it.
+  virtual void GetMasks(float prob_p, float prob_q, int num_bits,
+                        Bits* p_out, Bits* q_out) const {
+    for (int i = 0; num_bits > 0; ++i, num_bits -= 32) {
+      int word_bits = num_bits < 32 ? num_bits : 32;
+      GetMask(prob_p, word_bits, &p_out[i]);
+      GetMask(prob_q, word_bits, &q_out[i]);
+    }
+  }
 };
 
 // Dependencies
@@ -58,17 +83,33 @@ class Deps {
   Deps(HashFunc* const hash_func, const std::string& client_secret,
        HmacFunc* const hmac_func, const std::shared_ptr<IrrRandInterface> &irr_rand)
       : hash_func_(hash_func),
+        hash_into_func_(nullptr),
         client_secret_(client_secret),
         hmac_func_(hmac_func),
+        hmac_into_func_(nullptr),
+        irr_rand_(irr_rand) {
+  }
+
+  Deps(HashIntoFunc* const hash_func, const std::string& client_secret,
+       HmacIntoFunc* const hmac_func, const std::shared_ptr<IrrRandInterface> &irr_rand)
+      : hash_func_(nullptr),
+        hash_into_func_(hash_func),
+        client_secret_(client_secret),
+        hmac_func_(nullptr),
+        hmac_into_func_(hmac_func),
         irr_rand_(irr_rand) {
   }
 
  private:
   friend class Encoder;
+  friend class EncoderRegistry;
 
+  // Exactly one of each pair is set, depending on the constructor.
   HashFunc* hash_func_;  // for bloom filter
+  HashIntoFunc* hash_into_func_;
   const std::string client_secret_;  // for PRR; copy of constructor param
   HmacFunc* hmac_func_;  // PRR
+  HmacIntoFunc* hmac_into_func_;
   std::shared_ptr<IrrRandInterface> irr_rand_;  // IRR
 };
 
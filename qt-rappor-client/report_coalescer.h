@@ -0,0 +1,87 @@
+// Collapses a period's events into one report per metric.
+
+#pragma once
+
+#include "qt_rappor_global.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "encoder.h"
+
+namespace rappor {
+
+// RAPPOR sends at most one report per metric per reporting period.  Instead
+// of encoding every event and dropping most reports later, record events
+// here and Flush() once per period: only the value that will be reported is
+// encoded.
+//
+// Per metric, the coalescer keeps the value chosen by its Policy:
+//   kFirst, kLast:  the first or last value recorded in the period.
+//   kMostFrequent:  the most frequent value, tracked with a fixed number of
+//                   counters (the space-saving algorithm).  It is exact when
+//                   the period has at most max_candidates distinct values,
+//                   and otherwise finds any value seen in more than
+//                   1 / max_candidates of the events.
+//
+// Record() and Flush() may be called from any thread; each metric has its
+// own lock.  AddMetric() is not synchronized: add every metric before any
+// thread records.
+class QT_RAPPOR_EXPORT ReportCoalescer {
+ public:
+  enum Policy {
+    kFirst,
+    kLast,
+    kMostFrequent,
+  };
+
+  struct Report {
+    int metric;  // handle from AddMetric()
+    Bits irr;
+  };
+
+  ReportCoalescer();
+  ~ReportCoalescer();
+
+  // Adds a metric and returns its handle.  encoder is held by pointer and
+  // must outlive the coalescer.  Add all metrics before recording.
+  int AddMetric(const Encoder* encoder, Policy policy,
+                int max_candidates = 16);
+
+  // Unknown handles are logged and ignored.
+  void Record(int metric, std::string_view value);
+
+  // Number of Record() calls for metric in the current period, for local
+  // diagnostics.  Never upload it: unlike the report, the count isn't
+  // randomized and reveals how often the user triggered the metric.
+  uint32_t _EventCountInternal(int metric);
+
+  // Encodes one report for each metric with events in the period, appends
+  // them to reports, and starts a new period.  Returns false if any encode
+  // failed; that metric's report is left out.
+  bool Flush(std::vector<Report>* reports);
+
+ private:
+  struct Candidate {
+    std::string value;
+    uint32_t count = 0;
+  };
+  struct Metric {
+    const Encoder* encoder;
+    Policy policy;
+    std::mutex mutex;
+    uint32_t events = 0;
+    // One candidate for kFirst / kLast, max_candidates for kMostFrequent.
+    std::vector<Candidate> candidates;
+    size_t used = 0;
+  };
+
+  std::vector<std::unique_ptr<Metric>> metrics_;
+};
+
+}  // namespace rappor
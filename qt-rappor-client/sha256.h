@@ -0,0 +1,80 @@
+// SHA-256 and HMAC-SHA256 with access to intermediate state.
+//
+// QCryptographicHash and QMessageAuthenticationCode only hash complete
+// messages.  The PRR HMAC has a fixed key and a fixed message prefix per
+// encoder, so the encoder keeps a copy of the hash state after absorbing them
+// and only finishes the last few bytes per value.
+//
+// On x86 CPUs with the SHA extensions (SHA-NI) the compression function uses
+// them, selected at runtime.
+
+#pragma once
+
+#include "qt_rappor_global.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+
+namespace rappor {
+
+QT_RAPPOR_EXPORT extern const uint32_t kSha256InitialState[8];
+
+// Compresses num_blocks consecutive 64-byte blocks into the 8-word state.
+QT_RAPPOR_EXPORT void Sha256Compress(uint32_t* state, const uint8_t* blocks,
+                                     size_t num_blocks);
+
+// The portable implementation, for testing the accelerated ones against.
+QT_RAPPOR_EXPORT void Sha256CompressScalar(uint32_t* state,
+                                           const uint8_t* blocks,
+                                           size_t num_blocks);
+
+// Multi-buffer compression of independent messages: compresses blocks[i]
+// into the state at states + 8 * i, for i < num_lanes.  On x86 groups of 16
+// (AVX-512) or, without SHA-NI, 8 (AVX2) lanes run in parallel; the rest go
+// through Sha256Compress() one at a time.
+QT_RAPPOR_EXPORT void Sha256CompressLanes(uint32_t* states,
+                                          const uint8_t* const* blocks,
+                                          size_t num_lanes);
+
+class QT_RAPPOR_EXPORT Sha256Context {
+ public:
+  static const size_t kBlockSize = 64;
+  static const size_t kDigestSize = 32;
+
+  Sha256Context();
+
+  void Update(const void* data, size_t len);
+  // Writes kDigestSize bytes.  The object must not be updated afterwards.
+  void Final(uint8_t* digest);
+
+ private:
+  uint32_t state_[8];
+  uint64_t length_;  // total bytes absorbed
+  uint8_t buffer_[kBlockSize];
+  size_t buffered_;
+};
+
+// HMAC-SHA256 context.  The key pads are absorbed in the constructor, so a
+// copy of this object (optionally after some Update() calls) is a midstate
+// that many messages can be finished from.
+class QT_RAPPOR_EXPORT HmacSha256Context {
+ public:
+  explicit HmacSha256Context(std::string_view key);
+
+  void Update(const void* data, size_t len) { inner_.Update(data, len); }
+  // Writes Sha256Context::kDigestSize bytes.
+  void Final(uint8_t* digest);
+
+  // Many messages under one key can share a single context: start each from
+  // a copy of inner(), then finish it with Final(&inner, digest), which
+  // leaves this context unchanged.
+  const Sha256Context& inner() const { return inner_; }
+  void Final(Sha256Context* inner, uint8_t* digest) const;
+
+ private:
+  Sha256Context inner_;
+  Sha256Context outer_;
+};
+
+}  // namespace rappor
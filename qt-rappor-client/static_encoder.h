@@ -0,0 +1,146 @@
+// RAPPOR encoder specialized for compile-time constant parameters.
+
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "encoder.h"
+
+namespace rappor {
+
+// StaticEncoder takes its parameters as a type with static constexpr members,
+// which are checked with static_assert instead of at runtime:
+//
+//   struct MetricParams {
+//     static constexpr int num_bits = 32;
+//     static constexpr int num_hashes = 2;
+//     static constexpr int num_cohorts = 128;
+//     static constexpr float prob_f = 0.25f;
+//     static constexpr float prob_p = 0.75f;
+//     static constexpr float prob_q = 0.5f;
+//   };
+//   rappor::StaticEncoder<MetricParams> encoder("metric-name", deps);
+//
+// Reports are identical to those of an Encoder with the same parameters and
+// dependencies.  The Bloom filter and PRR mask loops are fully unrolled, and
+// stages that can't change the report are skipped: the PRR HMAC when
+// prob_f == 0, and the IRR randomness when prob_p == 0 and prob_q == 1.
+// Skipped stages don't draw from deps' IrrRandInterface.
+//
+// Only num_bits <= 32 (rappor::Bits reports) is supported.
+template <typename P>
+class StaticEncoder {
+  static_assert(P::num_bits > 0, "num_bits must be positive");
+  static_assert(P::num_bits <= 32, "num_bits can't be greater than 32");
+  static_assert(P::num_hashes > 0, "num_hashes must be positive");
+  static_assert(P::num_hashes <= 16, "num_hashes can't be greater than 16");
+  static_assert(P::num_cohorts > 0, "num_cohorts must be positive");
+  static_assert((P::num_cohorts & (P::num_cohorts - 1)) == 0,
+                "num_cohorts must be a power of 2");
+  static_assert(P::prob_f >= 0.0f && P::prob_f <= 1.0f,
+                "prob_f should be between 0.0 and 1.0 inclusive");
+  static_assert(P::prob_p >= 0.0f && P::prob_p <= 1.0f,
+                "prob_p should be between 0.0 and 1.0 inclusive");
+  static_assert(P::prob_q >= 0.0f && P::prob_q <= 1.0f,
+                "prob_q should be between 0.0 and 1.0 inclusive");
+
+  // Same quantization as Encoder.
+  static constexpr uint8_t kThreshold128 =
+      static_cast<uint8_t>(P::prob_f * 128);
+  static constexpr bool kHasPrr = kThreshold128 != 0;
+  static constexpr bool kHasIrr = !(P::prob_p == 0.0f && P::prob_q == 1.0f);
+
+ public:
+  StaticEncoder(const std::string& encoder_id, const Deps& deps)
+      : encoder_(encoder_id,
+                 Params(P::num_bits, P::num_hashes, P::num_cohorts, P::prob_f,
+                        P::prob_p, P::prob_q),
+                 deps) {
+  }
+
+  bool EncodeBits(const Bits bits, Bits* irr_out) const {
+    Bits unused_prr;
+    return _EncodeBitsInternal(bits, &unused_prr, irr_out);
+  }
+
+  bool EncodeString(std::string_view value, Bits* irr_out) const {
+    Bits unused_bloom;
+    Bits unused_prr;
+    return _EncodeStringInternal(value, &unused_bloom, &unused_prr, irr_out);
+  }
+
+  // For testing/simulation use only.
+  bool _EncodeBitsInternal(const Bits bits, Bits* prr_out, Bits* irr_out)
+      const try {
+    Bits prr = bits;
+    if (kHasPrr) {
+      uint8_t sha256[32];
+      if (!encoder_.PrrDigest(bits, sha256)) {
+        return false;
+      }
+      Bits uniform;
+      Bits f_mask;
+      PrrMasks(sha256, &uniform, &f_mask,
+               std::make_index_sequence<P::num_bits>());
+      prr = (bits & ~f_mask) | (uniform & f_mask);
+    }
+    *prr_out = prr;
+
+    Bits irr = prr;
+    if (kHasIrr) {
+      Bits p_bits;
+      Bits q_bits;
+      encoder_.GetIrrMasks(&p_bits, &q_bits);
+      irr = (p_bits & ~prr) | (q_bits & prr);
+    }
+    *irr_out = irr;
+    return true;
+  } catch (const std::exception& e) {  // from GetMask -> std::random
+    Encoder::LogWarning("Exception while encoding bits: ", e.what());
+    return false;
+  }
+
+  bool _EncodeStringInternal(std::string_view value, Bits* bloom_out,
+                             Bits* prr_out, Bits* irr_out) const {
+    uint8_t hash_output[64];
+    size_t hash_size;
+    if (!encoder_.BloomHash(value, hash_output, &hash_size)) {
+      Encoder::LogDebug("Hash function failed");
+      return false;
+    }
+    if (hash_size < static_cast<size_t>(P::num_hashes)) {
+      Encoder::LogDebug("Hash function didn't return enough bytes");
+      return false;
+    }
+    *bloom_out = BloomFilter(hash_output,
+                             std::make_index_sequence<P::num_hashes>());
+    return _EncodeBitsInternal(*bloom_out, prr_out, irr_out);
+  }
+
+  // Accessor for the assigned cohort.
+  uint32_t cohort() const { return encoder_.cohort(); }
+  // Set a cohort manually, if previously generated.
+  void set_cohort(uint32_t cohort) { encoder_.set_cohort(cohort); }
+
+ private:
+  template <size_t... I>
+  static Bits BloomFilter(const uint8_t* hash_output,
+                          std::index_sequence<I...>) {
+    return ((Bits(1) << (hash_output[I] % P::num_bits)) | ...);
+  }
+
+  template <size_t... I>
+  static void PrrMasks(const uint8_t* sha256, Bits* uniform, Bits* f_mask,
+                       std::index_sequence<I...>) {
+    *uniform = ((Bits(sha256[I] & 0x01) << I) | ...);
+    *f_mask = ((Bits((sha256[I] >> 1) < kThreshold128) << I) | ...);
+  }
+
+  // Does hashing, cohort assignment and runtime checks of deps.
+  Encoder encoder_;
+};
+
+}  // namespace rappor
@@ -5,10 +5,14 @@
 #include "rappor_deps.h"
 
 #include <memory>
+#include <mutex>
 #include <random>
 
 namespace rappor {
 
+// Thread-safe: the default StdRand draws from a per-thread engine seeded from
+// std::random_device, so concurrent encoders never share state or take locks.
+// A seeded StdRand replays one sequence and serializes its callers.
 class QT_RAPPOR_EXPORT StdRand : public IrrRandInterface
 {
 public:
@@ -17,11 +21,19 @@ public:
     // For unit testing (todo make private I guess)
     StdRand(const std::random_device::result_type);
 
+    // Probabilities are rounded to a multiple of 1/128, and each 32-bit
+    // mask costs 7 engine draws (none for a probability of 0 or 1).
     void GetMask(float prob, int num_bits, Bits* mask_out) const override;
+    void GetMasks(float prob_p, float prob_q, int num_bits,
+                  Bits* p_out, Bits* q_out) const override;
 
 private:
+    template <typename Fn>
+    void WithEngine(Fn fn) const;
 
+    // Only set for a seeded StdRand.
     std::unique_ptr<std::mt19937> m_engine;
+    mutable std::mutex m_mutex;
 };
 
 }  // namespace rappor
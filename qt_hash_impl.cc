@@ -14,100 +14,305 @@
 // limitations under the License.
 
 #include "qt-rappor-client/qt_hash_impl.h"
+#include "qt-rappor-client/md5.h"
+#include "qt-rappor-client/sha256.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 #include <string>
 
-#include <QCryptographicHash>
-#include <QMessageAuthenticationCode>
-
 namespace rappor {
 
+namespace {
+
+// Messages per lock-step group; matches the widest Sha256CompressLanes and
+// Md5CompressLanes kernels.
+const size_t kBatchLanes = 16;
+
+void StoreDigest(const uint32_t* state, uint8_t* digest) {
+  for (int i = 0; i < 8; ++i) {
+    digest[4 * i] = static_cast<uint8_t>(state[i] >> 24);
+    digest[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+    digest[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+    digest[4 * i + 3] = static_cast<uint8_t>(state[i]);
+  }
+}
+
+// Writes SHA-256 (big-endian length) or MD5 (little-endian length) padding
+// for a message of total_len bytes whose last partial block, tail_len < 64
+// bytes, is already at the start of 'tail'.  Returns the number of 64-byte
+// blocks in 'tail' (1 or 2).
+size_t PadTail(uint8_t* tail, size_t tail_len, uint64_t total_len,
+               bool little_endian_length = false) {
+  const size_t kBlock = Sha256Context::kBlockSize;
+  size_t blocks = tail_len + 9 > kBlock ? 2 : 1;
+  tail[tail_len] = 0x80;
+  memset(tail + tail_len + 1, 0, blocks * kBlock - tail_len - 1);
+  uint64_t bit_length = total_len * 8;
+  for (int i = 0; i < 8; ++i) {
+    size_t pos = little_endian_length ? blocks * kBlock - 8 + i
+                                      : blocks * kBlock - 1 - i;
+    tail[pos] = static_cast<uint8_t>(bit_length >> (8 * i));
+  }
+  return blocks;
+}
+
+typedef void CompressLanesFunc(uint32_t* states, const uint8_t* const* blocks,
+                               size_t num_lanes);
+
+// Compresses block j of each message in [0, count) that has one, gathering
+// the active lanes so the multi-buffer kernel sees them contiguously.  Each
+// state is 'words' 32-bit words.
+void CompressActive(CompressLanesFunc* compress_lanes, size_t words,
+                    uint32_t* states, const uint8_t* const* blocks,
+                    size_t count) {
+  uint32_t active_states[kBatchLanes * 8];
+  const uint8_t* active_blocks[kBatchLanes] = {};
+  size_t lane_of[kBatchLanes];
+  size_t active = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (blocks[i]) {
+      memcpy(active_states + words * active, states + words * i,
+             words * sizeof(uint32_t));
+      active_blocks[active] = blocks[i];
+      lane_of[active++] = i;
+    }
+  }
+  compress_lanes(active_states, active_blocks, active);
+  for (size_t k = 0; k < active; ++k) {
+    memcpy(states + words * lane_of[k], active_states + words * k,
+           words * sizeof(uint32_t));
+  }
+}
+
+void HmacSha256Group(const std::string_view* keys,
+                     const std::string_view* values, size_t count,
+                     HmacDigest* outputs) {
+  const size_t kBlock = Sha256Context::kBlockSize;
+  const size_t kDigest = Sha256Context::kDigestSize;
+
+  uint8_t ipad[kBatchLanes][kBlock];
+  uint8_t opad[kBatchLanes][kBlock];
+  uint8_t tail[kBatchLanes][2 * kBlock];
+  uint32_t inner[kBatchLanes * 8];
+  uint32_t outer[kBatchLanes * 8];
+  size_t full_blocks[kBatchLanes];
+  size_t total_blocks[kBatchLanes];
+  const uint8_t* blocks[kBatchLanes] = {};
+
+  size_t max_blocks = 0;
+  for (size_t i = 0; i < count; ++i) {
+    uint8_t key_block[kBlock] = {0};
+    if (keys[i].size() > kBlock) {
+      Sha256Context key_hash;
+      key_hash.Update(keys[i].data(), keys[i].size());
+      key_hash.Final(key_block);
+    } else {
+      memcpy(key_block, keys[i].data(), keys[i].size());
+    }
+    for (size_t b = 0; b < kBlock; ++b) {
+      ipad[i][b] = key_block[b] ^ 0x36;
+      opad[i][b] = key_block[b] ^ 0x5c;
+    }
+    memcpy(inner + 8 * i, kSha256InitialState, sizeof(kSha256InitialState));
+    memcpy(outer + 8 * i, kSha256InitialState, sizeof(kSha256InitialState));
+
+    // Whole blocks are read from the value in place; only the rest is
+    // copied out and padded.
+    size_t len = values[i].size();
+    full_blocks[i] = len / kBlock;
+    memcpy(tail[i], values[i].data() + full_blocks[i] * kBlock, len % kBlock);
+    total_blocks[i] = full_blocks[i] + PadTail(tail[i], len % kBlock,
+                                               kBlock + len);
+    max_blocks = std::max(max_blocks, total_blocks[i]);
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    blocks[i] = ipad[i];
+  }
+  Sha256CompressLanes(inner, blocks, count);
+  for (size_t i = 0; i < count; ++i) {
+    blocks[i] = opad[i];
+  }
+  Sha256CompressLanes(outer, blocks, count);
+
+  for (size_t j = 0; j < max_blocks; ++j) {
+    for (size_t i = 0; i < count; ++i) {
+      const uint8_t* value = reinterpret_cast<const uint8_t*>(values[i].data());
+      if (j < full_blocks[i]) {
+        blocks[i] = value + j * kBlock;
+      } else if (j < total_blocks[i]) {
+        blocks[i] = tail[i] + (j - full_blocks[i]) * kBlock;
+      } else {
+        blocks[i] = nullptr;
+      }
+    }
+    CompressActive(Sha256CompressLanes, 8, inner, blocks, count);
+  }
+
+  // Outer hash: one block holding the inner digest and padding.
+  for (size_t i = 0; i < count; ++i) {
+    StoreDigest(inner + 8 * i, tail[i]);
+    PadTail(tail[i], kDigest, kBlock + kDigest);
+    blocks[i] = tail[i];
+  }
+  Sha256CompressLanes(outer, blocks, count);
+  for (size_t i = 0; i < count; ++i) {
+    StoreDigest(outer + 8 * i, outputs[i].data());
+  }
+}
+
+void Md5Group(const std::string_view* values, size_t count,
+              HashDigest* outputs) {
+  const size_t kBlock = Md5Context::kBlockSize;
+
+  uint8_t tail[kBatchLanes][2 * kBlock];
+  uint32_t states[kBatchLanes * 4];
+  size_t full_blocks[kBatchLanes];
+  size_t total_blocks[kBatchLanes];
+  const uint8_t* blocks[kBatchLanes];
+
+  size_t max_blocks = 0;
+  for (size_t i = 0; i < count; ++i) {
+    memcpy(states + 4 * i, kMd5InitialState, sizeof(kMd5InitialState));
+    size_t len = values[i].size();
+    full_blocks[i] = len / kBlock;
+    memcpy(tail[i], values[i].data() + full_blocks[i] * kBlock, len % kBlock);
+    total_blocks[i] = full_blocks[i] + PadTail(tail[i], len % kBlock, len,
+                                               true);
+    max_blocks = std::max(max_blocks, total_blocks[i]);
+  }
+
+  for (size_t j = 0; j < max_blocks; ++j) {
+    for (size_t i = 0; i < count; ++i) {
+      const uint8_t* value = reinterpret_cast<const uint8_t*>(values[i].data());
+      if (j < full_blocks[i]) {
+        blocks[i] = value + j * kBlock;
+      } else if (j < total_blocks[i]) {
+        blocks[i] = tail[i] + (j - full_blocks[i]) * kBlock;
+      } else {
+        blocks[i] = nullptr;
+      }
+    }
+    CompressActive(Md5CompressLanes, 4, states, blocks, count);
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    for (int w = 0; w < 4; ++w) {
+      for (int b = 0; b < 4; ++b) {
+        outputs[i][4 * w + b] =
+            static_cast<uint8_t>(states[4 * i + w] >> (8 * b));
+      }
+    }
+  }
+}
+
+}  // namespace
+
 // of type HmacFunc in rappor_deps.h
 bool HmacSha256(const std::string& key, const std::string& value,
           std::vector<uint8_t>* output) {
-    QMessageAuthenticationCode code(QCryptographicHash::Sha256);
-    code.setKey(QByteArray::fromStdString(key));
-    code.addData(value.data(), value.size());
-    const QByteArray result = code.result();
-    output->resize(result.size());
-    memcpy(output->data(), result.data(), result.size());
-    return !result.isEmpty();
+  output->resize(Sha256Context::kDigestSize);
+  HmacSha256Context hmac(key);
+  hmac.Update(value.data(), value.size());
+  hmac.Final(output->data());
+  return true;
+}
+
+// of type HmacIntoFunc in rappor_deps.h
+bool HmacSha256Into(std::string_view key, std::string_view value,
+                    HmacDigest* output) {
+  HmacSha256Context hmac(key);
+  hmac.Update(value.data(), value.size());
+  hmac.Final(output->data());
+  return true;
+}
+
+bool HmacSha256Batch(const std::string_view* keys,
+                     const std::string_view* values, size_t count,
+                     HmacDigest* outputs) {
+  for (size_t i = 0; i < count; i += kBatchLanes) {
+    HmacSha256Group(keys + i, values + i, std::min(kBatchLanes, count - i),
+                    outputs + i);
+  }
+  return true;
 }
 
 // Of type HmacFunc in rappor_deps.h
 //
 // The length of the passed-in output vector determines how many
 // bytes are returned.
-//
-// No reseed operation, but recommended reseed_interval <= 2^48 updates.
-// Since we're seeding for each value and typically don't need
-// so many bytes, we should be OK.
 bool HmacDrbg(const std::string& key, const std::string& value,
               std::vector<uint8_t>* output) {
-  const unsigned char k_array[] = {
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-  };
-  std::string v;
-  std::vector<uint8_t> temp_output;
   size_t num_bytes = output->size();
   if (num_bytes == 0) {
     // By default return 32 bytes for Uint32 applications.
     num_bytes = 32;
   }
+  output->resize(num_bytes);
+  return HmacDrbgInto(key, value, output->data(), num_bytes);
+}
 
-  v.append(32u, 0x01);
-  temp_output.resize(32, 0);
-
-  std::string temp_str(v);
-  temp_str.append(std::string("\0", 1));
-  // provided_data is key|value.
-  temp_str.append(key);
-  temp_str.append(value);
+// No reseed operation, but recommended reseed_interval <= 2^48 updates.
+// Since we're seeding for each value and typically don't need
+// so many bytes, we should be OK.
+bool HmacDrbgInto(std::string_view key, std::string_view value,
+                  uint8_t* output, size_t output_size) {
+  const size_t kSize = Sha256Context::kDigestSize;
+  uint8_t k[kSize];
+  uint8_t v[kSize];
+  memset(k, 0x00, kSize);
+  memset(v, 0x01, kSize);
 
-  output->resize(0);
+  // Instantiate: two rounds of the update function, where provided_data is
+  // key|value.
+  for (uint8_t round = 0; round < 2; ++round) {
+    HmacSha256Context k_hmac(std::string_view(reinterpret_cast<char*>(k), kSize));
+    k_hmac.Update(v, kSize);
+    k_hmac.Update(&round, 1);
+    k_hmac.Update(key.data(), key.size());
+    k_hmac.Update(value.data(), value.size());
+    k_hmac.Final(k);
 
-  // Instantiate.
-  if (!HmacSha256(std::string(k_array, k_array + 32), temp_str, &temp_output)) {
-    return false;
+    HmacSha256Context v_hmac(std::string_view(reinterpret_cast<char*>(k), kSize));
+    v_hmac.Update(v, kSize);
+    v_hmac.Final(v);
   }
-  std::string k(temp_output.begin(), temp_output.end());
-  if (!HmacSha256(k, v, &temp_output)) {
-    return false;
-  }
-  v = std::string(temp_output.begin(), temp_output.end());
-  if (!HmacSha256(k, v + std::string("\1", 1) + key + value, &temp_output)) {
-    return false;
-  }
-  k = std::string(temp_output.begin(), temp_output.end());
-  if (!HmacSha256(k, v, &temp_output)) {
-    return false;
-  }
-  v = std::string(temp_output.begin(), temp_output.end());
 
-  while (output->size() < num_bytes) {
-    // Generate.
-    if (!HmacSha256(k, v, &temp_output)) {
-      return false;
-    }
-    v = std::string(temp_output.begin(), temp_output.end());
-    output->insert(output->end(), temp_output.begin(), temp_output.end());
+  // Generate.
+  size_t written = 0;
+  while (written < output_size) {
+    HmacSha256Context v_hmac(std::string_view(reinterpret_cast<char*>(k), kSize));
+    v_hmac.Update(v, kSize);
+    v_hmac.Final(v);
+
+    size_t n = std::min(kSize, output_size - written);
+    memcpy(output + written, v, n);
+    written += n;
   }
-  output->resize(num_bytes);
   return true;
 }
 
 // of type HashFunc in rappor_deps.h
 bool Md5(const std::string& value, std::vector<uint8_t>* output) {
-    static QCryptographicHash hasher(QCryptographicHash::Md5);
-    hasher.addData(value.data(), value.size());
-    const QByteArray result = hasher.result();
-    output->resize(result.size());
-    memcpy(output->data(), result.data(), result.size());
-    return true;
+  output->resize(Md5Context::kDigestSize);
+  Md5Context::Hash(value.data(), value.size(), output->data());
+  return true;
+}
+
+// of type HashIntoFunc in rappor_deps.h
+bool Md5Into(std::string_view value, HashDigest* output) {
+  Md5Context::Hash(value.data(), value.size(), output->data());
+  return true;
+}
+
+bool Md5Batch(const std::string_view* values, size_t count,
+              HashDigest* outputs) {
+  for (size_t i = 0; i < count; i += kBatchLanes) {
+    Md5Group(values + i, std::min(kBatchLanes, count - i), outputs + i);
+  }
+  return true;
 }
 
 }  // namespace rappor
@@ -23,6 +23,7 @@
 #include <QDebug>
 
 #include "qt-rappor-client/encoder.h"
+#include "qt-rappor-client/philox_rand_impl.h"
 #include "qt-rappor-client/std_rand_impl.h"
 #include "qt-rappor-client/qt_hash_impl.h"
 
@@ -74,9 +75,10 @@ void PrintBitString(const std::string& s) {
 }
 
 int main(int argc, char** argv) {
-  if (argc != 7) {
+  if (argc != 7 && argc != 8) {
     qWarning(
-        "Usage: rappor_encode <num bits> <num hashes> <num cohorts> p q f");
+        "Usage: rappor_encode <num bits> <num hashes> <num cohorts> p q f "
+        "[irr seed]");
     exit(1);
   }
 
@@ -116,6 +118,20 @@ int main(int argc, char** argv) {
     exit(1);
   }
 
+  // With a seed, the IRR of each row depends only on (seed, client, row
+  // number), so the output is reproducible and rows could be encoded in
+  // parallel.
+  bool reproducible = argc == 8;
+  uint64_t irr_seed = 0;
+  if (reproducible) {
+    char* end;
+    irr_seed = strtoull(argv[7], &end, 10);
+    if (end == argv[7]) {
+      qWarning("Invalid IRR seed: '%s'", argv[7]);
+      exit(1);
+    }
+  }
+
   rappor::Params params(num_bits, num_hashes, num_cohorts, prob_f, prob_p,
                         prob_q);
 
@@ -131,6 +147,7 @@ int main(int argc, char** argv) {
   std::shared_ptr<rappor::IrrRandInterface> irr_rand = std::make_shared<rappor::StdRand>();
 
   std::string line;
+  uint32_t row = 0;
 
   // CSV header
   std::cout << "client,cohort,bloom,prr,irr\n";
@@ -171,6 +188,12 @@ int main(int argc, char** argv) {
     // everything after
     std::string value = line.substr(comma2_pos + 1);
 
+    if (reproducible) {
+      irr_rand = std::make_shared<rappor::PhiloxRand>(
+          irr_seed, rappor::PhiloxRand::ClientId(client_str), row);
+    }
+    ++row;
+
     rappor::Deps deps(rappor::Md5, client_str /*client_secret*/,
                       rappor::HmacSha256, irr_rand);
 
@@ -0,0 +1,122 @@
+#include "qt-rappor-client/report_coalescer.h"
+
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(rapporLog)
+
+namespace rappor {
+
+ReportCoalescer::ReportCoalescer() {
+}
+
+ReportCoalescer::~ReportCoalescer() {
+}
+
+int ReportCoalescer::AddMetric(const Encoder* encoder, Policy policy,
+                               int max_candidates) {
+  if (policy == kMostFrequent && max_candidates <= 0) {
+    qFatal("max_candidates must be positive");
+  }
+  auto metric = std::make_unique<Metric>();
+  metric->encoder = encoder;
+  metric->policy = policy;
+  metric->candidates.resize(policy == kMostFrequent ? max_candidates : 1);
+  metrics_.push_back(std::move(metric));
+  return static_cast<int>(metrics_.size() - 1);
+}
+
+void ReportCoalescer::Record(int metric_handle, std::string_view value) {
+  if (metric_handle < 0 ||
+      static_cast<size_t>(metric_handle) >= metrics_.size()) {
+    qCDebug(rapporLog, "Unknown metric handle %d", metric_handle);
+    return;
+  }
+  Metric& metric = *metrics_[metric_handle];
+  std::lock_guard<std::mutex> lock(metric.mutex);
+  ++metric.events;
+
+  // Candidate strings keep their capacity across periods, so steady-state
+  // recording doesn't allocate.
+  switch (metric.policy) {
+    case kFirst:
+      if (metric.used == 0) {
+        metric.candidates[0].value.assign(value.data(), value.size());
+        metric.used = 1;
+      }
+      return;
+
+    case kLast:
+      metric.candidates[0].value.assign(value.data(), value.size());
+      metric.used = 1;
+      return;
+
+    case kMostFrequent: {
+      for (size_t i = 0; i < metric.used; ++i) {
+        if (metric.candidates[i].value == value) {
+          ++metric.candidates[i].count;
+          return;
+        }
+      }
+      if (metric.used < metric.candidates.size()) {
+        Candidate& fresh = metric.candidates[metric.used++];
+        fresh.value.assign(value.data(), value.size());
+        fresh.count = 1;
+        return;
+      }
+      // Space-saving: replace the least frequent candidate and inherit its
+      // count as the new value's overestimate.
+      Candidate* min = &metric.candidates[0];
+      for (Candidate& candidate : metric.candidates) {
+        if (candidate.count < min->count) {
+          min = &candidate;
+        }
+      }
+      min->value.assign(value.data(), value.size());
+      ++min->count;
+      return;
+    }
+  }
+}
+
+uint32_t ReportCoalescer::_EventCountInternal(int metric_handle) {
+  if (metric_handle < 0 ||
+      static_cast<size_t>(metric_handle) >= metrics_.size()) {
+    return 0;
+  }
+  Metric& metric = *metrics_[metric_handle];
+  std::lock_guard<std::mutex> lock(metric.mutex);
+  return metric.events;
+}
+
+bool ReportCoalescer::Flush(std::vector<Report>* reports) {
+  bool ok = true;
+  for (size_t i = 0; i < metrics_.size(); ++i) {
+    Metric& metric = *metrics_[i];
+    std::lock_guard<std::mutex> lock(metric.mutex);
+    if (metric.used == 0) {
+      continue;
+    }
+
+    const Candidate* chosen = &metric.candidates[0];
+    for (size_t j = 1; j < metric.used; ++j) {
+      if (metric.candidates[j].count > chosen->count) {
+        chosen = &metric.candidates[j];
+      }
+    }
+
+    Report report;
+    report.metric = static_cast<int>(i);
+    if (metric.encoder->EncodeString(chosen->value, &report.irr)) {
+      reports->push_back(report);
+    } else {
+      qCDebug(rapporLog, "Encoding the report for metric %zu failed", i);
+      ok = false;
+    }
+
+    metric.events = 0;
+    metric.used = 0;
+  }
+  return ok;
+}
+
+}  // namespace rappor
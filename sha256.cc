@@ -0,0 +1,464 @@
+#include "qt-rappor-client/sha256.h"
+
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define RAPPOR_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace rappor {
+
+const uint32_t kSha256InitialState[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+  0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+namespace {
+
+const uint32_t kRoundConstants[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+  0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+  0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+  0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+  0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+  0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline uint32_t Rotr(uint32_t x, int n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+inline uint32_t LoadBigEndian32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) |
+         static_cast<uint32_t>(p[3]);
+}
+
+inline void StoreBigEndian32(uint32_t v, uint8_t* p) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+typedef void CompressFunc(uint32_t*, const uint8_t*, size_t);
+
+// Process one 64-byte block.
+void CompressBlock(uint32_t state[8], const uint8_t* block) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; ++i) {
+    w[i] = LoadBigEndian32(block + 4 * i);
+  }
+  for (int i = 16; i < 64; ++i) {
+    uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+
+  uint32_t a = state[0];
+  uint32_t b = state[1];
+  uint32_t c = state[2];
+  uint32_t d = state[3];
+  uint32_t e = state[4];
+  uint32_t f = state[5];
+  uint32_t g = state[6];
+  uint32_t h = state[7];
+
+  for (int i = 0; i < 64; ++i) {
+    uint32_t s1 = Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25);
+    uint32_t ch = (e & f) ^ (~e & g);
+    uint32_t t1 = h + s1 + ch + kRoundConstants[i] + w[i];
+    uint32_t s0 = Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22);
+    uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+    uint32_t t2 = s0 + maj;
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+#ifdef RAPPOR_SHA256_X86
+
+// SHA extensions: two rounds per sha256rnds2, with the message schedule
+// computed by sha256msg1/sha256msg2.  The state is kept as ABEF / CDGH.
+__attribute__((target("sha,sse4.1")))
+void CompressShaNi(uint32_t* state, const uint8_t* data, size_t num_blocks) {
+  const __m128i byte_swap =
+      _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+  __m128i state1 =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4));
+  tmp = _mm_shuffle_epi32(tmp, 0xB1);          // CDAB
+  state1 = _mm_shuffle_epi32(state1, 0x1B);    // EFGH
+  __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);  // ABEF
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0);       // CDGH
+
+  for (; num_blocks > 0; --num_blocks, data += Sha256Context::kBlockSize) {
+    const __m128i abef = state0;
+    const __m128i cdgh = state1;
+    // msg[g % 4] holds schedule words [4g, 4g + 4).
+    __m128i msg[4];
+
+#pragma GCC unroll 16
+    for (int g = 0; g < 16; ++g) {
+      if (g < 4) {
+        msg[g] = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * g)),
+            byte_swap);
+      }
+      __m128i k = _mm_add_epi32(
+          msg[g % 4], _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+                          kRoundConstants + 4 * g)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, k);
+      if (g >= 3 && g <= 14) {
+        __m128i& next = msg[(g + 1) % 4];
+        next = _mm_add_epi32(next,
+                             _mm_alignr_epi8(msg[g % 4], msg[(g + 3) % 4], 4));
+        next = _mm_sha256msg2_epu32(next, msg[g % 4]);
+      }
+      k = _mm_shuffle_epi32(k, 0x0E);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, k);
+      if (g >= 1 && g <= 12) {
+        msg[(g + 3) % 4] = _mm_sha256msg1_epu32(msg[(g + 3) % 4], msg[g % 4]);
+      }
+    }
+
+    state0 = _mm_add_epi32(state0, abef);
+    state1 = _mm_add_epi32(state1, cdgh);
+  }
+
+  tmp = _mm_shuffle_epi32(state0, 0x1B);       // FEBA
+  state1 = _mm_shuffle_epi32(state1, 0xB1);    // DCHG
+  state0 = _mm_blend_epi16(tmp, state1, 0xF0); // DCBA
+  state1 = _mm_alignr_epi8(state1, tmp, 8);    // ABEF
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state), state0);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), state1);
+}
+
+// Multi-buffer kernels: lane l of each vector belongs to message l, so the
+// rounds run on 8 (AVX2) or 16 (AVX-512) independent blocks at once.  The
+// body is shared; the per-ISA macros below supply the vector operations.
+#define RAPPOR_SHA256_LANES_BODY(kLanes)                                     \
+  alignas(64) uint32_t words[16][kLanes];                                    \
+  for (int i = 0; i < 16; ++i) {                                             \
+    for (int l = 0; l < kLanes; ++l) {                                       \
+      words[i][l] = LoadBigEndian32(blocks[l] + 4 * i);                      \
+    }                                                                        \
+  }                                                                          \
+  alignas(64) uint32_t lanes[8][kLanes];                                     \
+  for (int j = 0; j < 8; ++j) {                                              \
+    for (int l = 0; l < kLanes; ++l) {                                       \
+      lanes[j][l] = states[8 * l + j];                                       \
+    }                                                                        \
+  }                                                                          \
+  V w[16];                                                                   \
+  for (int i = 0; i < 16; ++i) {                                             \
+    w[i] = LOAD(words[i]);                                                   \
+  }                                                                          \
+  V a = LOAD(lanes[0]);                                                      \
+  V b = LOAD(lanes[1]);                                                      \
+  V c = LOAD(lanes[2]);                                                      \
+  V d = LOAD(lanes[3]);                                                      \
+  V e = LOAD(lanes[4]);                                                      \
+  V f = LOAD(lanes[5]);                                                      \
+  V g = LOAD(lanes[6]);                                                      \
+  V h = LOAD(lanes[7]);                                                      \
+  for (int i = 0; i < 64; ++i) {                                             \
+    if (i >= 16) {                                                           \
+      V w15 = w[(i + 1) & 15];                                               \
+      V w2 = w[(i + 14) & 15];                                               \
+      V s0 = XOR3(ROTR(w15, 7), ROTR(w15, 18), SHR(w15, 3));                 \
+      V s1 = XOR3(ROTR(w2, 17), ROTR(w2, 19), SHR(w2, 10));                  \
+      w[i & 15] = ADD(ADD(w[i & 15], s0), ADD(w[(i + 9) & 15], s1));         \
+    }                                                                        \
+    V t1 = ADD(ADD(h, XOR3(ROTR(e, 6), ROTR(e, 11), ROTR(e, 25))),           \
+               ADD(CH(e, f, g),                                              \
+                   ADD(SET1(kRoundConstants[i]), w[i & 15])));               \
+    V t2 = ADD(XOR3(ROTR(a, 2), ROTR(a, 13), ROTR(a, 22)), MAJ(a, b, c));    \
+    h = g;                                                                   \
+    g = f;                                                                   \
+    f = e;                                                                   \
+    e = ADD(d, t1);                                                          \
+    d = c;                                                                   \
+    c = b;                                                                   \
+    b = a;                                                                   \
+    a = ADD(t1, t2);                                                         \
+  }                                                                          \
+  STORE(lanes[0], ADD(LOAD(lanes[0]), a));                                   \
+  STORE(lanes[1], ADD(LOAD(lanes[1]), b));                                   \
+  STORE(lanes[2], ADD(LOAD(lanes[2]), c));                                   \
+  STORE(lanes[3], ADD(LOAD(lanes[3]), d));                                   \
+  STORE(lanes[4], ADD(LOAD(lanes[4]), e));                                   \
+  STORE(lanes[5], ADD(LOAD(lanes[5]), f));                                   \
+  STORE(lanes[6], ADD(LOAD(lanes[6]), g));                                   \
+  STORE(lanes[7], ADD(LOAD(lanes[7]), h));                                   \
+  for (int j = 0; j < 8; ++j) {                                              \
+    for (int l = 0; l < kLanes; ++l) {                                       \
+      states[8 * l + j] = lanes[j][l];                                       \
+    }                                                                        \
+  }
+
+typedef void LanesFunc(uint32_t*, const uint8_t* const*);
+
+#define V __m256i
+#define LOAD(p) _mm256_load_si256(reinterpret_cast<const __m256i*>(p))
+#define STORE(p, x) _mm256_store_si256(reinterpret_cast<__m256i*>(p), x)
+#define SET1(x) _mm256_set1_epi32(static_cast<int>(x))
+#define ADD(x, y) _mm256_add_epi32(x, y)
+#define SHR(x, n) _mm256_srli_epi32(x, n)
+#define ROTR(x, n) \
+  _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+#define XOR3(x, y, z) _mm256_xor_si256(_mm256_xor_si256(x, y), z)
+#define CH(x, y, z) _mm256_xor_si256(z, _mm256_and_si256(x, _mm256_xor_si256(y, z)))
+#define MAJ(x, y, z)                           \
+  _mm256_or_si256(_mm256_and_si256(x, y),      \
+                  _mm256_and_si256(z, _mm256_or_si256(x, y)))
+
+__attribute__((target("avx2")))
+void Lanes8Avx2(uint32_t* states, const uint8_t* const* blocks) {
+  RAPPOR_SHA256_LANES_BODY(8)
+}
+
+#undef V
+#undef LOAD
+#undef STORE
+#undef SET1
+#undef ADD
+#undef SHR
+#undef ROTR
+#undef XOR3
+#undef CH
+#undef MAJ
+
+// AVX-512 has a rotate instruction, and ternary logic covers Ch, Maj and the
+// three-way XORs in one instruction each.
+#define V __m512i
+#define LOAD(p) _mm512_load_si512(p)
+#define STORE(p, x) _mm512_store_si512(p, x)
+#define SET1(x) _mm512_set1_epi32(static_cast<int>(x))
+#define ADD(x, y) _mm512_add_epi32(x, y)
+// The all-lanes maskz forms avoid GCC's uninitialized-value warnings about
+// the placeholder operand of the unmasked shift and rotate intrinsics.
+#define SHR(x, n) _mm512_maskz_srli_epi32(0xFFFF, x, n)
+#define ROTR(x, n) _mm512_maskz_ror_epi32(0xFFFF, x, n)
+#define XOR3(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0x96)
+#define CH(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0xCA)
+#define MAJ(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0xE8)
+
+__attribute__((target("avx512f")))
+void Lanes16Avx512(uint32_t* states, const uint8_t* const* blocks) {
+  RAPPOR_SHA256_LANES_BODY(16)
+}
+
+#undef V
+#undef LOAD
+#undef STORE
+#undef SET1
+#undef ADD
+#undef SHR
+#undef ROTR
+#undef XOR3
+#undef CH
+#undef MAJ
+#undef RAPPOR_SHA256_LANES_BODY
+
+// __builtin_cpu_supports() has no name for the SHA extensions in older
+// compilers, so read CPUID leaf 7 directly.
+bool HasShaNi() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  const unsigned int kSha = 1u << 29;
+  return (ebx & kSha) && __builtin_cpu_supports("sse4.1");
+}
+
+CompressFunc* SelectCompress() {
+  __builtin_cpu_init();
+  if (HasShaNi()) {
+    return CompressShaNi;
+  }
+  return Sha256CompressScalar;
+}
+
+LanesFunc* SelectLanes16() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx512f") ? Lanes16Avx512 : nullptr;
+}
+
+// Eight AVX2 lanes are no faster than eight SHA-NI compressions, so they are
+// only used on CPUs without the SHA extensions.
+LanesFunc* SelectLanes8() {
+  __builtin_cpu_init();
+  if (HasShaNi()) {
+    return nullptr;
+  }
+  return __builtin_cpu_supports("avx2") ? Lanes8Avx2 : nullptr;
+}
+
+#else
+
+CompressFunc* SelectCompress() {
+  return Sha256CompressScalar;
+}
+
+#endif  // RAPPOR_SHA256_X86
+
+}  // namespace
+
+void Sha256CompressScalar(uint32_t* state, const uint8_t* blocks,
+                          size_t num_blocks) {
+  for (size_t i = 0; i < num_blocks; ++i) {
+    CompressBlock(state, blocks + i * Sha256Context::kBlockSize);
+  }
+}
+
+void Sha256Compress(uint32_t* state, const uint8_t* blocks,
+                    size_t num_blocks) {
+  static CompressFunc* const compress = SelectCompress();
+  compress(state, blocks, num_blocks);
+}
+
+void Sha256CompressLanes(uint32_t* states, const uint8_t* const* blocks,
+                         size_t num_lanes) {
+#ifdef RAPPOR_SHA256_X86
+  static LanesFunc* const lanes16 = SelectLanes16();
+  static LanesFunc* const lanes8 = SelectLanes8();
+  if (lanes16) {
+    for (; num_lanes >= 16; num_lanes -= 16, states += 8 * 16, blocks += 16) {
+      lanes16(states, blocks);
+    }
+  }
+  if (lanes8) {
+    for (; num_lanes >= 8; num_lanes -= 8, states += 8 * 8, blocks += 8) {
+      lanes8(states, blocks);
+    }
+  }
+#endif
+  for (size_t i = 0; i < num_lanes; ++i) {
+    Sha256Compress(states + 8 * i, blocks[i], 1);
+  }
+}
+
+Sha256Context::Sha256Context() : length_(0), buffered_(0) {
+  memcpy(state_, kSha256InitialState, sizeof(state_));
+}
+
+void Sha256Context::Update(const void* data, size_t len) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  length_ += len;
+
+  if (buffered_ > 0) {
+    size_t n = kBlockSize - buffered_;
+    if (n > len) {
+      n = len;
+    }
+    memcpy(buffer_ + buffered_, p, n);
+    buffered_ += n;
+    p += n;
+    len -= n;
+    if (buffered_ < kBlockSize) {
+      return;
+    }
+    Sha256Compress(state_, buffer_, 1);
+    buffered_ = 0;
+  }
+
+  if (len >= kBlockSize) {
+    size_t num_blocks = len / kBlockSize;
+    Sha256Compress(state_, p, num_blocks);
+    p += num_blocks * kBlockSize;
+    len -= num_blocks * kBlockSize;
+  }
+
+  if (len > 0) {
+    memcpy(buffer_, p, len);
+    buffered_ = len;
+  }
+}
+
+void Sha256Context::Final(uint8_t* digest) {
+  uint64_t bit_length = length_ * 8;
+
+  // Append 0x80, pad with zeros to 56 mod 64, then the big-endian length.
+  buffer_[buffered_++] = 0x80;
+  if (buffered_ > kBlockSize - 8) {
+    memset(buffer_ + buffered_, 0, kBlockSize - buffered_);
+    Sha256Compress(state_, buffer_, 1);
+    buffered_ = 0;
+  }
+  memset(buffer_ + buffered_, 0, kBlockSize - 8 - buffered_);
+  StoreBigEndian32(static_cast<uint32_t>(bit_length >> 32), buffer_ + 56);
+  StoreBigEndian32(static_cast<uint32_t>(bit_length), buffer_ + 60);
+  Sha256Compress(state_, buffer_, 1);
+
+  for (int i = 0; i < 8; ++i) {
+    StoreBigEndian32(state_[i], digest + 4 * i);
+  }
+}
+
+HmacSha256Context::HmacSha256Context(std::string_view key) {
+  uint8_t key_block[Sha256Context::kBlockSize] = {0};
+  if (key.size() > Sha256Context::kBlockSize) {
+    Sha256Context key_hash;
+    key_hash.Update(key.data(), key.size());
+    key_hash.Final(key_block);
+  } else {
+    memcpy(key_block, key.data(), key.size());
+  }
+
+  uint8_t pad[Sha256Context::kBlockSize];
+  for (size_t i = 0; i < Sha256Context::kBlockSize; ++i) {
+    pad[i] = key_block[i] ^ 0x36;
+  }
+  inner_.Update(pad, sizeof(pad));
+  for (size_t i = 0; i < Sha256Context::kBlockSize; ++i) {
+    pad[i] = key_block[i] ^ 0x5c;
+  }
+  outer_.Update(pad, sizeof(pad));
+}
+
+void HmacSha256Context::Final(uint8_t* digest) {
+  uint8_t inner_digest[Sha256Context::kDigestSize];
+  inner_.Final(inner_digest);
+  outer_.Update(inner_digest, sizeof(inner_digest));
+  outer_.Final(digest);
+}
+
+void HmacSha256Context::Final(Sha256Context* inner, uint8_t* digest) const {
+  uint8_t inner_digest[Sha256Context::kDigestSize];
+  inner->Final(inner_digest);
+  Sha256Context outer(outer_);
+  outer.Update(inner_digest, sizeof(inner_digest));
+  outer.Final(digest);
+}
+
+}  // namespace rappor
@@ -1,5 +1,7 @@
 #include "qt-rappor-client/std_rand_impl.h"
 
+#include "qt-rappor-client/bitsliced_mask.h"
+
 #include <cstdint>
 #include <memory>
 
@@ -7,10 +9,6 @@ namespace rappor {
 
 StdRand::StdRand()
 {
-    // This should be a hardware-backed source according to the spec
-    std::random_device entropySource;
-
-    m_engine = std::make_unique<std::mt19937>(entropySource());
 }
 
 // For unit testing only
@@ -19,16 +17,39 @@ StdRand::StdRand(const std::random_device::result_type seed)
     m_engine = std::make_unique<std::mt19937>(seed);
 }
 
+template <typename Fn>
+void StdRand::WithEngine(Fn fn) const
+{
+    if (m_engine) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        fn(*m_engine);
+        return;
+    }
+
+    // This should be a hardware-backed source according to the spec
+    thread_local std::mt19937 threadEngine(std::random_device{}());
+    fn(threadEngine);
+}
+
 void StdRand::GetMask(float prob, int num_bits, Bits* mask_out) const
 {
-    Bits mask = 0;
-    std::bernoulli_distribution distribution(prob);
+    WithEngine([&](std::mt19937& engine) {
+        *mask_out = BitslicedMask(Threshold128(prob), engine) & LowBits(num_bits);
+    });
+}
 
-    for (int i = 0; i < num_bits; ++i) {
-        uint8_t bit = distribution(*m_engine) ? 1 : 0;
-        mask |= (bit << i);
-    }
-    *mask_out = mask;
+void StdRand::GetMasks(float prob_p, float prob_q, int num_bits,
+                       Bits* p_out, Bits* q_out) const
+{
+    const uint32_t p_threshold = Threshold128(prob_p);
+    const uint32_t q_threshold = Threshold128(prob_q);
+
+    WithEngine([&](std::mt19937& engine) {
+        for (int i = 0; num_bits > 0; ++i, num_bits -= 32) {
+            p_out[i] = BitslicedMask(p_threshold, engine) & LowBits(num_bits);
+            q_out[i] = BitslicedMask(q_threshold, engine) & LowBits(num_bits);
+        }
+    });
 }
 
 }  // namespace rappor
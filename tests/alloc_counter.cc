@@ -0,0 +1,45 @@
+#include "alloc_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<bool> counting(false);
+std::atomic<int> num_allocations(0);
+
+}  // namespace
+
+void* operator new(size_t size) {
+  if (counting) {
+    ++num_allocations;
+  }
+  void* p = std::malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
+
+namespace rappor {
+
+void StartCountingAllocations() {
+  num_allocations = 0;
+  counting = true;
+}
+
+int StopCountingAllocations() {
+  counting = false;
+  return num_allocations;
+}
+
+}  // namespace rappor
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace rappor {
+
+// Counts calls to the global operator new between Start and Stop.  The
+// replacement operators live in alloc_counter.cc.
+void StartCountingAllocations();
+// Returns the number of allocations since StartCountingAllocations().
+int StopCountingAllocations();
+
+}  // namespace rappor
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "qt-rappor-client/chacha20.h"
+#include "qt-rappor-client/chacha_rand_impl.h"
+#include "rand_test_util.h"
+
+// RFC 8439, section 2.3.2.
+TEST(ChaCha20Test, BlockTestVector) {
+  uint8_t key[rappor::kChaCha20KeySize];
+  for (size_t i = 0; i < sizeof(key); ++i) {
+    key[i] = static_cast<uint8_t>(i);
+  }
+  const uint8_t nonce[rappor::kChaCha20NonceSize] = {
+    0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x4a, 0x00, 0x00, 0x00, 0x00
+  };
+  const uint8_t expected[rappor::kChaCha20BlockSize] = {
+    0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15,
+    0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+    0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03,
+    0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+    0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09,
+    0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+    0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9,
+    0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e
+  };
+  uint8_t block[rappor::kChaCha20BlockSize];
+  rappor::ChaCha20Keystream(key, nonce, 1, 1, block);
+  EXPECT_EQ(0, memcmp(expected, block, sizeof(block)));
+}
+
+TEST(ChaCha20Test, VectorKernelsMatchScalar) {
+  uint8_t key[rappor::kChaCha20KeySize];
+  uint8_t nonce[rappor::kChaCha20NonceSize];
+  for (size_t i = 0; i < sizeof(key); ++i) {
+    key[i] = static_cast<uint8_t>(i * 7 + 3);
+  }
+  for (size_t i = 0; i < sizeof(nonce); ++i) {
+    nonce[i] = static_cast<uint8_t>(i * 13 + 1);
+  }
+  // Counters near the wrap, and block counts that leave a tail.
+  for (uint32_t counter : { 0u, 1u, 0xfffffffbu }) {
+    for (size_t blocks : { 1, 3, 4, 7, 8, 13, 16 }) {
+      std::vector<uint8_t> expected(blocks * rappor::kChaCha20BlockSize);
+      std::vector<uint8_t> actual(expected.size());
+      rappor::ChaCha20KeystreamScalar(key, nonce, counter, blocks,
+                                      expected.data());
+      rappor::ChaCha20Keystream(key, nonce, counter, blocks, actual.data());
+      EXPECT_EQ(expected, actual) << counter << " " << blocks;
+    }
+  }
+}
+
+TEST(ChaChaRandTest, GetMasksMatchesProbability) {
+  rappor::ChaChaRand seeded(42);
+  rappor::ChaChaRand rand;
+  for (float prob : { 0.25f, 0.5f, 0.75f, 0.1f }) {
+    EXPECT_NEAR(prob, rappor::SetFraction(seeded, prob), 0.01) << prob;
+    EXPECT_NEAR(prob, rappor::SetFraction(rand, prob), 0.01) << prob;
+  }
+}
+
+TEST(ChaChaRandTest, SeededIsReproducible) {
+  rappor::ChaChaRand a(7);
+  rappor::ChaChaRand b(7);
+  rappor::ChaChaRand c(8);
+  for (int i = 0; i < 100; ++i) {
+    rappor::Bits pa[2], qa[2], pb[2], qb[2], pc[2], qc[2];
+    a.GetMasks(0.5f, 0.25f, 64, pa, qa);
+    b.GetMasks(0.5f, 0.25f, 64, pb, qb);
+    c.GetMasks(0.5f, 0.25f, 64, pc, qc);
+    EXPECT_EQ(pa[0], pb[0]);
+    EXPECT_EQ(qa[1], qb[1]);
+    EXPECT_NE(pa[0], pc[0]);
+  }
+}
+
+TEST(ChaChaRandTest, GetMasksClearsHighBits) {
+  rappor::ChaChaRand rand;
+  rappor::Bits p[2];
+  rappor::Bits q[2];
+  rand.GetMasks(1.0f, 1.0f, 40, p, q);
+  EXPECT_EQ(~rappor::Bits(0), p[0]);
+  EXPECT_EQ(0xffu, q[1]);
+  rand.GetMasks(0.0f, 0.5f, 12, p, q);
+  EXPECT_EQ(0u, p[0]);
+  EXPECT_EQ(0u, q[0] & ~0xfffu);
+}
+
+// Parent and child must not continue the same keystream after fork().
+TEST(ChaChaRandTest, ForkReseeds) {
+  rappor::ChaChaRand rand;
+  rappor::Bits mask;
+  rand.GetMask(0.5f, 32, &mask);  // make sure this thread's generator exists
+
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    rappor::Bits child[8];
+    for (rappor::Bits& word : child) {
+      rand.GetMask(0.5f, 32, &word);
+    }
+    ssize_t written = write(fds[1], child, sizeof(child));
+    _exit(written == sizeof(child) ? 0 : 1);
+  }
+  rappor::Bits parent[8];
+  for (rappor::Bits& word : parent) {
+    rand.GetMask(0.5f, 32, &word);
+  }
+  rappor::Bits child[8];
+  ASSERT_EQ(ssize_t(sizeof(child)), read(fds[0], child, sizeof(child)));
+  int status = 0;
+  waitpid(pid, &status, 0);
+  close(fds[0]);
+  close(fds[1]);
+  EXPECT_NE(0, memcmp(parent, child, sizeof(parent)));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
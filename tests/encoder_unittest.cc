@@ -1,8 +1,26 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <list>
+#include <memory>
 #include <stdexcept>
+#include <thread>
 
+#include <QBuffer>
+#include <QThreadPool>
+
+#include "qt-rappor-client/async_encoder.h"
+#include "qt-rappor-client/bloom_cache.h"
+#include "qt-rappor-client/encode_stream.h"
 #include "qt-rappor-client/encoder.h"
+#include "qt-rappor-client/encoder_registry.h"
+#include "qt-rappor-client/enum_encoder.h"
+#include "qt-rappor-client/prr_cache.h"
+#include "qt-rappor-client/prr_masks.h"
 #include "qt-rappor-client/qt_hash_impl.h"
+#include "qt-rappor-client/report_coalescer.h"
+#include "qt-rappor-client/static_encoder.h"
+#include "qt-rappor-client/std_rand_impl.h"
+#include "alloc_counter.h"
 #include "mock_rand_impl.h"
 
 class EncoderTest : public ::testing::Test {
@@ -238,6 +256,552 @@ TEST_F(EncoderUint32Test, StringUint32AndStringVectorMatch) {
   ASSERT_EQ(expected_out, bits_vector);
 }
 
+// Batch encoding should give the same reports as encoding one at a time.
+TEST_F(EncoderUint32Test, EncodeStringsMatchesEncodeString) {
+  const std::string values[] = { "foo", "bar", "", std::string("\0a", 2) };
+  const size_t count = sizeof(values) / sizeof(values[0]);
+
+  rappor::Bits blooms[count];
+  rappor::Bits prrs[count];
+  rappor::Bits irrs[count];
+  ASSERT_TRUE(encoder->_EncodeStringsInternal(values, count, blooms, prrs,
+                                              irrs));
+  for (size_t i = 0; i < count; ++i) {
+    rappor::Bits bloom, prr, irr;
+    ASSERT_TRUE(encoder->_EncodeStringInternal(values[i], &bloom, &prr, &irr));
+    ASSERT_EQ(bloom, blooms[i]);
+    ASSERT_EQ(prr, prrs[i]);
+    ASSERT_EQ(irr, irrs[i]);
+  }
+
+  ASSERT_TRUE(encoder->EncodeStrings(values, count, irrs));
+  ASSERT_TRUE(encoder->EncodeString("foo", &bits_out));
+  ASSERT_EQ(bits_out, irrs[0]);
+}
+
+// More values than one multi-buffer MD5 group, of assorted lengths.
+TEST_F(EncoderUint32Test, EncodeStringsBloomMatchesMakeBloomFilter) {
+  std::vector<std::string> values;
+  for (size_t i = 0; i < 37; ++i) {
+    values.push_back(std::string((i * 11) % 90, static_cast<char>('a' + i)));
+  }
+  const size_t count = values.size();
+
+  std::vector<rappor::Bits> blooms(count);
+  std::vector<rappor::Bits> prrs(count);
+  std::vector<rappor::Bits> irrs(count);
+  ASSERT_TRUE(encoder->_EncodeStringsInternal(values.data(), count,
+                                              blooms.data(), prrs.data(),
+                                              irrs.data()));
+  for (size_t i = 0; i < count; ++i) {
+    rappor::Bits bloom, prr, irr;
+    ASSERT_TRUE(encoder->_EncodeStringInternal(values[i], &bloom, &prr, &irr));
+    ASSERT_EQ(bloom, blooms[i]) << values[i].size();
+    ASSERT_EQ(prr, prrs[i]) << values[i].size();
+  }
+}
+
+TEST_F(EncoderUint32Test, EncodeBitsBatchMatchesEncodeBits) {
+  const rappor::Bits bits[] = { 0x0, 0x123, 0x80000001, 0xffffffff };
+  const size_t count = sizeof(bits) / sizeof(bits[0]);
+
+  rappor::Bits irrs[count];
+  ASSERT_TRUE(encoder->EncodeBitsBatch(bits, count, irrs));
+  for (size_t i = 0; i < count; ++i) {
+    ASSERT_TRUE(encoder->EncodeBits(bits[i], &bits_out));
+    ASSERT_EQ(bits_out, irrs[i]);
+  }
+}
+
+static int hmac_calls = 0;
+
+static bool CountingHmacSha256(const std::string& key, const std::string& value,
+                               std::vector<uint8_t>* output) {
+  ++hmac_calls;
+  return rappor::HmacSha256(key, value, output);
+}
+
+// Cached PRR masks must match freshly computed ones, and skip the HMAC.
+TEST_F(EncoderUint32Test, PrrCacheSkipsHmac) {
+  for (size_t cache_size : { size_t(2), size_t(1) << 16 }) {
+    for (int num_bits : { 8, 32 }) {
+      rappor::Params p(num_bits, 2, 128, 0.25, 0.75, 0.5);
+      rappor::Deps d(rappor::Md5, "client-secret", CountingHmacSha256,
+                     irr_rand);
+      rappor::Encoder uncached(encoder_id, p, d);
+      rappor::Encoder cached(encoder_id, p, d);
+      cached.set_prr_cache_size(cache_size);
+
+      for (const char* value : { "foo", "bar", "foo", "baz", "foo" }) {
+        rappor::Bits bloom, prr, irr;
+        rappor::Bits cached_bloom, cached_prr, cached_irr;
+        ASSERT_TRUE(uncached._EncodeStringInternal(value, &bloom, &prr, &irr));
+        ASSERT_TRUE(cached._EncodeStringInternal(value, &cached_bloom,
+                                                 &cached_prr, &cached_irr));
+        ASSERT_EQ(prr, cached_prr);
+        ASSERT_EQ(irr, cached_irr);
+      }
+
+      // "foo" was the most recent value, so it's still cached even in the
+      // 2-entry LRU.
+      hmac_calls = 0;
+      ASSERT_TRUE(cached.EncodeString("foo", &bits_out));
+      ASSERT_EQ(0, hmac_calls);
+      ASSERT_TRUE(uncached.EncodeString("foo", &bits_out));
+      ASSERT_EQ(1, hmac_calls);
+    }
+  }
+}
+
+// The sparse LRU against a std::list model, with enough churn to evict and
+// re-insert keys that collide in the hash index.
+TEST(PrrCacheTest, LruMatchesModel) {
+  const size_t kMaxEntries = 37;
+  rappor::PrrCache cache(32, kMaxEntries);
+  ASSERT_FALSE(cache.dense());
+  std::list<rappor::Bits> model;  // most recently used first
+
+  uint32_t x = 12345;
+  for (int i = 0; i < 20000; ++i) {
+    x = x * 1103515245 + 12345;
+    rappor::Bits bits = (x >> 16) % 97 * 0x10001;
+    rappor::Bits uniform, f_mask;
+    bool hit = cache.Lookup(bits, &uniform, &f_mask);
+    auto it = std::find(model.begin(), model.end(), bits);
+    ASSERT_EQ(it != model.end(), hit) << i;
+    if (hit) {
+      ASSERT_EQ(bits ^ 0xffffffff, uniform);
+      ASSERT_EQ(bits * 3, f_mask);
+      model.splice(model.begin(), model, it);
+    } else {
+      cache.Insert(bits, bits ^ 0xffffffff, bits * 3);
+      if (model.size() == kMaxEntries) {
+        model.pop_back();
+      }
+      model.push_front(bits);
+    }
+    ASSERT_EQ(model.size(), cache.size());
+  }
+}
+
+TEST(PrrCacheTest, LruDoesNotAllocate) {
+  rappor::PrrCache cache(32, 16);
+  rappor::Bits uniform, f_mask;
+  rappor::StartCountingAllocations();
+  for (rappor::Bits bits = 0; bits < 1000; ++bits) {
+    if (!cache.Lookup(bits % 50, &uniform, &f_mask)) {
+      cache.Insert(bits % 50, bits, bits);
+    }
+  }
+  ASSERT_EQ(0, rappor::StopCountingAllocations());
+  ASSERT_EQ(16u, cache.size());
+}
+
+// Encoders are shared between threads without locking.  Each thread must get
+// the same Bloom filters and PRRs as a serial run; build with
+// -fsanitize=thread to check for races.
+TEST_F(EncoderUint32Test, ConcurrentEncodeMatchesSerial) {
+  const int kThreads = 4;
+  const int kValues = 64;
+  const int kRounds = 20;
+
+  std::vector<std::string> values;
+  for (int i = 0; i < kValues; ++i) {
+    values.push_back("value-" + std::to_string(i));
+  }
+
+  rappor::Deps std_deps(rappor::Md5, "client-secret", rappor::HmacSha256,
+                        std::make_shared<rappor::StdRand>());
+  for (int num_bits : { 8, 32 }) {
+    rappor::Params p(num_bits, 2, 128, 0.25, 0.75, 0.5);
+    rappor::Encoder serial(encoder_id, p, std_deps);
+    rappor::Encoder shared(encoder_id, p, std_deps);
+    shared.set_prr_cache_size(16);  // dense for 8 bits, a busy LRU for 32
+
+    std::vector<rappor::Bits> blooms(kValues), prrs(kValues);
+    for (int i = 0; i < kValues; ++i) {
+      rappor::Bits irr;
+      ASSERT_TRUE(serial._EncodeStringInternal(values[i], &blooms[i],
+                                               &prrs[i], &irr));
+    }
+
+    std::vector<int> mismatches(kThreads, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&, t]() {
+        for (int round = 0; round < kRounds; ++round) {
+          for (int j = 0; j < kValues; ++j) {
+            int i = (j * (t + 1) + round) % kValues;
+            rappor::Bits bloom, prr, irr;
+            if (!shared._EncodeStringInternal(values[i], &bloom, &prr, &irr) ||
+                bloom != blooms[i] || prr != prrs[i]) {
+              ++mismatches[t];
+            }
+          }
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    for (int t = 0; t < kThreads; ++t) {
+      EXPECT_EQ(0, mismatches[t]) << "thread " << t << " bits " << num_bits;
+    }
+  }
+}
+
+static int hash_calls = 0;
+
+static bool CountingMd5(const std::string& value,
+                        std::vector<uint8_t>* output) {
+  ++hash_calls;
+  return rappor::Md5(value, output);
+}
+
+// A shared Bloom cache serves every encoder with the same cohort and shape,
+// and skips the hash on hits.
+TEST_F(EncoderUint32Test, BloomCacheSkipsHash) {
+  rappor::Deps d(CountingMd5, "client-secret", rappor::HmacSha256, irr_rand);
+  auto cache = std::make_shared<rappor::BloomCache>(4);
+  rappor::Encoder uncached("metric-a", *params, d);
+  rappor::Encoder a("metric-a", *params, d);
+  rappor::Encoder b("metric-b", *params, d);
+  rappor::Encoder other_cohort("metric-c", *params, d);
+  other_cohort.set_cohort((a.cohort() + 1) % 128);
+  a.set_bloom_cache(cache);
+  b.set_bloom_cache(cache);
+  other_cohort.set_bloom_cache(cache);
+
+  rappor::Bits expected, bloom, prr, irr;
+  ASSERT_TRUE(uncached._EncodeStringInternal("foo", &expected, &prr, &irr));
+
+  hash_calls = 0;
+  ASSERT_TRUE(a._EncodeStringInternal("foo", &bloom, &prr, &irr));
+  ASSERT_EQ(expected, bloom);
+  ASSERT_EQ(1, hash_calls);
+  ASSERT_TRUE(b._EncodeStringInternal("foo", &bloom, &prr, &irr));
+  ASSERT_EQ(expected, bloom);
+  ASSERT_EQ(1, hash_calls);
+  ASSERT_EQ(1u, cache->hits());
+  ASSERT_EQ(1u, cache->misses());
+
+  ASSERT_TRUE(other_cohort._EncodeStringInternal("foo", &bloom, &prr, &irr));
+  ASSERT_EQ(2, hash_calls);
+
+  // Many more values than the cache holds: still correct, still bounded.
+  for (int i = 0; i < 100; ++i) {
+    std::string value = "value-" + std::to_string(i % 10);
+    ASSERT_TRUE(uncached._EncodeStringInternal(value, &expected, &prr, &irr));
+    ASSERT_TRUE(a._EncodeStringInternal(value, &bloom, &prr, &irr));
+    ASSERT_EQ(expected, bloom) << value;
+  }
+  ASSERT_EQ(4u, cache->capacity());
+}
+
+TEST_F(EncoderUint32Test, FanOutSharesBloomFilter) {
+  rappor::Deps d(CountingMd5, "client-secret", rappor::HmacSha256, irr_rand);
+  rappor::Params narrow(16, 2, 128, 0.25, 0.75, 0.5);
+  rappor::Encoder a("metric-a", *params, d);
+  rappor::Encoder b("metric-b", *params, d);
+  rappor::Encoder c("metric-c", narrow, d);
+  rappor::Encoder e("metric-e", *params, d);
+  const rappor::Encoder* encoders[] = { &a, &b, &c, &e };
+
+  rappor::Bits irrs[4];
+  hash_calls = 0;
+  ASSERT_TRUE(rappor::Encoder::EncodeStringFanOut("foo", encoders, 4, irrs));
+  ASSERT_EQ(2, hash_calls);  // one per filter shape
+
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(encoders[i]->EncodeString("foo", &bits_out));
+    ASSERT_EQ(bits_out, irrs[i]) << i;
+  }
+}
+
+TEST_F(EncoderUint32Test, EnumEncoderMatchesEncoder) {
+  const std::vector<std::string> domain = { "ok", "timeout", "refused", "" };
+  rappor::EnumEncoder bloom_enum(encoder, domain);
+  rappor::EnumEncoder one_hot(encoder, domain, rappor::EnumEncoder::kOneHot);
+  ASSERT_EQ(domain.size(), bloom_enum.size());
+
+  for (size_t i = 0; i < domain.size(); ++i) {
+    ASSERT_EQ(static_cast<int>(i), bloom_enum.IndexOf(domain[i]));
+
+    rappor::Bits bloom, prr, irr;
+    rappor::Bits enum_bloom, enum_prr, enum_irr;
+    ASSERT_TRUE(encoder->_EncodeStringInternal(domain[i], &bloom, &prr, &irr));
+    ASSERT_TRUE(bloom_enum._EncodeIndexInternal(i, &enum_bloom, &enum_prr,
+                                                &enum_irr));
+    ASSERT_EQ(bloom, enum_bloom);
+    ASSERT_EQ(prr, enum_prr);
+    ASSERT_EQ(irr, enum_irr);
+    ASSERT_TRUE(bloom_enum.EncodeString(domain[i], &bits_out));
+    ASSERT_EQ(irr, bits_out);
+
+    ASSERT_TRUE(encoder->_EncodeBitsInternal(rappor::Bits(1) << i, &prr,
+                                             &irr));
+    ASSERT_TRUE(one_hot._EncodeIndexInternal(i, &enum_bloom, &enum_prr,
+                                             &enum_irr));
+    ASSERT_EQ(rappor::Bits(1) << i, enum_bloom);
+    ASSERT_EQ(prr, enum_prr);
+    ASSERT_EQ(irr, enum_irr);
+  }
+
+  ASSERT_EQ(-1, bloom_enum.IndexOf("unknown"));
+  ASSERT_FALSE(bloom_enum.EncodeString("unknown", &bits_out));
+  ASSERT_FALSE(bloom_enum.EncodeIndex(domain.size(), &bits_out));
+}
+
+// Copies must not look members up through the source's strings.
+TEST_F(EncoderUint32Test, EnumEncoderCopyOutlivesSource) {
+  const std::vector<std::string> domain = {
+    "a member long enough to live on the heap", "ok" };
+  auto source = std::make_unique<rappor::EnumEncoder>(encoder, domain);
+  rappor::EnumEncoder copy(*source);
+  rappor::EnumEncoder assigned(encoder, { "other" });
+  assigned = *source;
+  source.reset();
+
+  for (const rappor::EnumEncoder* e : { &copy, &assigned }) {
+    ASSERT_EQ(2u, e->size());
+    ASSERT_EQ(0, e->IndexOf(domain[0]));
+    ASSERT_EQ(1, e->IndexOf("ok"));
+    ASSERT_EQ(-1, e->IndexOf("other"));
+    ASSERT_TRUE(e->EncodeString(domain[0], &bits_out));
+  }
+}
+
+TEST_F(EncoderUint32Test, QtStringsMatchUtf8) {
+  // "héllo €" plus U+1F600 (a surrogate pair).
+  const char16_t utf16[] = u"h\u00e9llo \u20ac\U0001F600";
+  const std::string utf8 = "h\xc3\xa9llo \xe2\x82\xac\xf0\x9f\x98\x80";
+  rappor::Bits expected;
+  ASSERT_TRUE(encoder->EncodeString(utf8, &expected));
+
+  ASSERT_TRUE(encoder->EncodeString(QStringView(utf16), &bits_out));
+  ASSERT_EQ(expected, bits_out);
+  ASSERT_TRUE(encoder->EncodeUtf8(QByteArray(utf8.data(), utf8.size()),
+                                  &bits_out));
+  ASSERT_EQ(expected, bits_out);
+
+  // An unpaired surrogate is replaced, as QString::toUtf8() does.
+  const char16_t lone[] = { u'a', 0xd800, u'b' };
+  ASSERT_TRUE(encoder->EncodeString("a\xef\xbf\xbd" "b", &expected));
+  ASSERT_TRUE(encoder->EncodeString(QStringView(lone, 3), &bits_out));
+  ASSERT_EQ(expected, bits_out);
+}
+
+TEST_F(EncoderUint32Test, EncodeStreamMatchesEncodeString) {
+  std::string value;
+  for (int i = 0; i < 20000; ++i) {
+    value += std::to_string(i);
+  }
+  rappor::Bits expected;
+  ASSERT_TRUE(encoder->EncodeString(value, &expected));
+
+  // Incremental MD5, and a hash function that needs the whole value.
+  rappor::Deps counting_deps(CountingMd5, "client-secret", rappor::HmacSha256,
+                             irr_rand);
+  rappor::Encoder buffered(encoder_id, *params, counting_deps);
+  for (const rappor::Encoder* e : { encoder, &buffered }) {
+    rappor::EncodeStream stream(e);
+    stream.Update("discarded");
+    stream.BeginValue();
+    for (size_t pos = 0; pos < value.size(); pos += 1000) {
+      stream.Update(std::string_view(value).substr(pos, 1000));
+    }
+    ASSERT_TRUE(stream.Finish(&bits_out));
+    ASSERT_EQ(expected, bits_out);
+
+    // Finish() starts the next value.
+    QByteArray bytes(value.data(), value.size());
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+    ASSERT_TRUE(stream.Update(&buffer));
+    ASSERT_TRUE(stream.Finish(&bits_out));
+    ASSERT_EQ(expected, bits_out);
+  }
+}
+
+// A QBuffer that claims to be a pipe.
+class SequentialBuffer : public QBuffer {
+ public:
+  using QBuffer::QBuffer;
+  bool isSequential() const override { return true; }
+};
+
+TEST_F(EncoderUint32Test, EncodeStreamRejectsSequentialDevice) {
+  QByteArray bytes("value");
+  SequentialBuffer device(&bytes);
+  device.open(QIODevice::ReadOnly);
+  rappor::EncodeStream stream(encoder);
+  stream.Update("abc");
+  ASSERT_FALSE(stream.Update(&device));
+
+  // Nothing was read, so the stream still holds just "abc".
+  rappor::Bits expected;
+  ASSERT_TRUE(encoder->EncodeString("abc", &expected));
+  ASSERT_TRUE(stream.Finish(&bits_out));
+  ASSERT_EQ(expected, bits_out);
+}
+
+TEST_F(EncoderUint32Test, CoalescerEncodesOncePerPeriod) {
+  rappor::Deps d(CountingMd5, "client-secret", rappor::HmacSha256, irr_rand);
+  rappor::Encoder e(encoder_id, *params, d);
+  rappor::ReportCoalescer coalescer;
+  int first = coalescer.AddMetric(&e, rappor::ReportCoalescer::kFirst);
+  int last = coalescer.AddMetric(&e, rappor::ReportCoalescer::kLast);
+  int most = coalescer.AddMetric(&e, rappor::ReportCoalescer::kMostFrequent,
+                                 3);
+  int idle = coalescer.AddMetric(&e, rappor::ReportCoalescer::kLast);
+
+  hash_calls = 0;
+  for (const char* value : { "a", "b", "c", "b", "d", "b", "e" }) {
+    coalescer.Record(first, value);
+    coalescer.Record(last, value);
+    coalescer.Record(most, value);
+  }
+  // Out-of-range handles are ignored.
+  coalescer.Record(-1, "x");
+  coalescer.Record(4, "x");
+  ASSERT_EQ(0, hash_calls);
+  ASSERT_EQ(7u, coalescer._EventCountInternal(most));
+  ASSERT_EQ(0u, coalescer._EventCountInternal(idle));
+
+  std::vector<rappor::ReportCoalescer::Report> reports;
+  ASSERT_TRUE(coalescer.Flush(&reports));
+  ASSERT_EQ(3, hash_calls);
+  ASSERT_EQ(3u, reports.size());
+
+  const char* expected[] = { "a", "e", "b" };
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(i, reports[i].metric);
+    ASSERT_TRUE(e.EncodeString(expected[i], &bits_out));
+    ASSERT_EQ(bits_out, reports[i].irr) << expected[i];
+  }
+  ASSERT_NE(idle, reports.back().metric);
+  ASSERT_EQ(0u, coalescer._EventCountInternal(most));
+
+  // A new period starts empty.
+  reports.clear();
+  ASSERT_TRUE(coalescer.Flush(&reports));
+  ASSERT_TRUE(reports.empty());
+}
+
+// HmacSha256 is finished from a precomputed midstate; a custom HMAC function
+// goes through the generic path.  Both must give the same PRR.
+TEST_F(EncoderUint32Test, PrrMidstateMatchesHmacFunc) {
+  rappor::Deps generic_deps(rappor::Md5, "client-secret", CountingHmacSha256,
+                            irr_rand);
+  rappor::Encoder generic(encoder_id, *params, generic_deps);
+
+  for (rappor::Bits bits : { 0x0u, 0x123u, 0xdeadbeefu, 0xffffffffu }) {
+    rappor::Bits prr, irr, generic_prr, generic_irr;
+    ASSERT_TRUE(encoder->_EncodeBitsInternal(bits, &prr, &irr));
+    ASSERT_TRUE(generic._EncodeBitsInternal(bits, &generic_prr, &generic_irr));
+    ASSERT_EQ(generic_prr, prr);
+  }
+}
+
+// Once the per-thread scratch buffers are warm, encoding must not touch the
+// heap.
+TEST_F(EncoderUint32Test, EncodeDoesNotAllocate) {
+  const std::string values[] = { "a much longer value than the others", "foo",
+                                 "" };
+  rappor::Bits irrs[3];
+  ASSERT_TRUE(encoder->EncodeStrings(values, 3, irrs));  // warm up
+
+  rappor::StartCountingAllocations();
+  bool ok = encoder->EncodeString("foo", &bits_out);
+  ok = ok && encoder->EncodeString(std::string_view("bar"), &bits_out);
+  ok = ok && encoder->EncodeBits(0x123, &bits_out);
+  ok = ok && encoder->EncodeStrings(values, 3, irrs);
+  int num_allocations = rappor::StopCountingAllocations();
+
+  ASSERT_TRUE(ok);
+  ASSERT_EQ(0, num_allocations);
+}
+
+// For num_bits <= 32 the byte-vector and fixed-width reports hold the same
+// bits as the Uint32 one.
+TEST_F(EncoderUint32Test, WideReportsMatchUint32) {
+  for (const char* value : { "foo", "bar", "" }) {
+    ASSERT_TRUE(encoder->EncodeString(value, &bits_out));
+
+    rappor::Bits64 wide_out;
+    ASSERT_TRUE(encoder->EncodeString(value, &wide_out));
+    ASSERT_EQ(rappor::Bits64(bits_out), wide_out);
+
+    ASSERT_TRUE(encoder->EncodeString(value, &bits_vector));
+    ASSERT_EQ(rappor::Bits64(bits_out),
+              rappor::Bits64::FromBytes(bits_vector.data(),
+                                        bits_vector.size()));
+  }
+
+  rappor::Bits64 wide_out;
+  ASSERT_TRUE(encoder->EncodeBits(rappor::Bits64(0x123), &wide_out));
+  ASSERT_TRUE(encoder->EncodeBits(0x123, &bits_out));
+  ASSERT_EQ(rappor::Bits64(bits_out), wide_out);
+}
+
+struct StaticParams {
+  static constexpr int num_bits = 32;
+  static constexpr int num_hashes = 2;
+  static constexpr int num_cohorts = 128;
+  static constexpr float prob_f = 0.25f;
+  static constexpr float prob_p = 0.75f;
+  static constexpr float prob_q = 0.5f;
+};
+
+// No PRR or IRR noise: the report is the Bloom filter.
+struct NoNoiseParams {
+  static constexpr int num_bits = 16;
+  static constexpr int num_hashes = 3;
+  static constexpr int num_cohorts = 64;
+  static constexpr float prob_f = 0.0f;
+  static constexpr float prob_p = 0.0f;
+  static constexpr float prob_q = 1.0f;
+};
+
+TEST_F(EncoderUint32Test, StaticEncoderMatchesEncoder) {
+  rappor::StaticEncoder<StaticParams> static_encoder(encoder_id, *deps);
+  const rappor::StaticEncoder<StaticParams>& const_encoder = static_encoder;
+  ASSERT_EQ(encoder->cohort(), const_encoder.cohort());
+
+  for (const char* value : { "foo", "bar", "" }) {
+    rappor::Bits bloom, prr, irr;
+    rappor::Bits static_bloom, static_prr, static_irr;
+    ASSERT_TRUE(encoder->_EncodeStringInternal(value, &bloom, &prr, &irr));
+    ASSERT_TRUE(static_encoder._EncodeStringInternal(value, &static_bloom,
+                                                     &static_prr, &static_irr));
+    ASSERT_EQ(bloom, static_bloom);
+    ASSERT_EQ(prr, static_prr);
+    ASSERT_EQ(irr, static_irr);
+  }
+
+  ASSERT_TRUE(encoder->EncodeBits(0x123, &bits_out));
+  rappor::Bits static_out;
+  ASSERT_TRUE(static_encoder.EncodeBits(0x123, &static_out));
+  ASSERT_EQ(bits_out, static_out);
+}
+
+TEST_F(EncoderUint32Test, StaticEncoderSkipsNoiseStages) {
+  rappor::Deps std_deps(rappor::Md5, "client-secret", rappor::HmacSha256,
+                        std::make_shared<rappor::StdRand>());
+  rappor::Params no_noise(NoNoiseParams::num_bits, NoNoiseParams::num_hashes,
+                          NoNoiseParams::num_cohorts, NoNoiseParams::prob_f,
+                          NoNoiseParams::prob_p, NoNoiseParams::prob_q);
+  rappor::Encoder runtime_encoder(encoder_id, no_noise, std_deps);
+  rappor::StaticEncoder<NoNoiseParams> static_encoder(encoder_id, std_deps);
+
+  rappor::Bits bloom, prr, irr;
+  ASSERT_TRUE(runtime_encoder._EncodeStringInternal("foo", &bloom, &prr, &irr));
+  ASSERT_EQ(bloom, irr);
+  ASSERT_TRUE(static_encoder._EncodeStringInternal("foo", &bloom, &prr, &irr));
+  ASSERT_EQ(bloom, prr);
+  ASSERT_EQ(bloom, irr);
+}
+
 ///// EncoderUnlimTest
 
 TEST_F(EncoderUnlimTest, EncodeStringUint64) {
@@ -249,6 +813,245 @@ TEST_F(EncoderUnlimTest, EncodeStringUint64) {
   ASSERT_EQ(93, encoder->cohort());
 }
 
+TEST_F(EncoderUnlimTest, EncodeDoesNotAllocate) {
+  ASSERT_TRUE(encoder->EncodeString("warm up", &bits_vector));
+
+  rappor::StartCountingAllocations();
+  bool ok = encoder->EncodeString("foo", &bits_vector);
+  int num_allocations = rappor::StopCountingAllocations();
+
+  ASSERT_TRUE(ok);
+  ASSERT_EQ(0, num_allocations);
+}
+
+TEST_F(EncoderUnlimTest, WideReportsMatchVector) {
+  for (const char* value : { "foo", "bar", "" }) {
+    ASSERT_TRUE(encoder->EncodeString(value, &bits_vector));
+
+    rappor::Bits64 out64;
+    ASSERT_TRUE(encoder->EncodeString(value, &out64));
+    ASSERT_EQ(rappor::Bits64::FromBytes(bits_vector.data(), bits_vector.size()),
+              out64);
+
+    // A wider report has the same low bits.
+    rappor::Bits256 out256;
+    ASSERT_TRUE(encoder->EncodeString(value, &out256));
+    ASSERT_EQ(rappor::Bits256::FromBytes(bits_vector.data(),
+                                         bits_vector.size()),
+              out256);
+  }
+}
+
+TEST_F(EncoderUnlimTest, EncodeStreamMatchesWide) {
+  rappor::Bits64 expected, irr;
+  ASSERT_TRUE(encoder->EncodeString("a long value", &expected));
+  rappor::EncodeStream stream(encoder);
+  stream.Update("a long ");
+  stream.Update("value");
+  ASSERT_TRUE(stream.Finish(&irr));
+  ASSERT_EQ(expected, irr);
+}
+
+// A report narrower than the encoder's num_bits is refused, not overrun.
+TEST_F(EncoderUnlimTest, EncodeStreamRejectsNarrowReport) {
+  rappor::Params wide(1024, 8, 128, 0.25, 0.75, 0.5);
+  rappor::Encoder wide_encoder(encoder_id, wide, *deps);
+  rappor::EncodeStream stream(&wide_encoder);
+  stream.Update("a long value");
+  rappor::Bits64 irr;
+  ASSERT_FALSE(stream.Finish(&irr));
+
+  // The stream starts on a new value either way.
+  rappor::BasicBits<1024> expected, wide_irr;
+  ASSERT_TRUE(wide_encoder.EncodeString("foo", &expected));
+  stream.Update("foo");
+  ASSERT_TRUE(stream.Finish(&wide_irr));
+  ASSERT_EQ(expected, wide_irr);
+}
+
+TEST(BasicBitsTest, BytesRoundTrip) {
+  uint8_t bytes[24];
+  for (int i = 0; i < 24; ++i) {
+    bytes[i] = static_cast<uint8_t>(i * 37 + 1);
+  }
+  rappor::Bits256 bits = rappor::Bits256::FromBytes(bytes, 24);
+  ASSERT_EQ(bytes[23], bits.lane(0) & 0xff);  // last byte is least significant
+  ASSERT_EQ(0u, bits.lane(3));
+
+  uint8_t out[24];
+  bits.ToBytes(out, 24);
+  ASSERT_EQ(0, memcmp(bytes, out, 24));
+
+  rappor::Bits256 mask;
+  mask.set(0);
+  mask.set(200);
+  ASSERT_TRUE(Select(bits, ~bits, mask).test(200));
+  ASSERT_EQ(AndNot(bits, mask) | (bits & mask), bits);
+}
+
+TEST(PrrMasksTest, MatchesScalar) {
+  uint8_t bytes[1024];
+  for (int i = 0; i < 1024; ++i) {
+    bytes[i] = static_cast<uint8_t>((i * 131 + 7) ^ (i >> 3));
+  }
+  for (int num_bits : { 1, 8, 16, 31, 32, 40, 64, 200, 256, 1024 }) {
+    for (int threshold : { 0, 1, 32, 64, 127, 128 }) {
+      uint64_t uniform[16], f_mask[16];
+      uint64_t expected_uniform[16], expected_f_mask[16];
+      rappor::ExtractPrrMasks(bytes, num_bits, threshold, uniform, f_mask);
+      rappor::ExtractPrrMasksScalar(bytes, num_bits, threshold,
+                                    expected_uniform, expected_f_mask);
+      for (int w = 0; w < (num_bits + 63) / 64; ++w) {
+        ASSERT_EQ(expected_uniform[w], uniform[w]) << num_bits << " " << w;
+        ASSERT_EQ(expected_f_mask[w], f_mask[w])
+            << num_bits << " " << threshold << " " << w;
+      }
+    }
+  }
+}
+
+TEST_F(EncoderUint32Test, RegistryMatchesEncoder) {
+  rappor::Deps drbg_deps(rappor::Md5, "client-secret", rappor::HmacDrbg,
+                         irr_rand);
+  rappor::Params wide_params(128, 2, 64, 0.25, 0.75, 0.5);
+  rappor::EncoderRegistry registry(*deps);
+  rappor::EncoderRegistry drbg_registry(drbg_deps);
+
+  std::vector<std::string> names;
+  for (int i = 0; i < 300; ++i) {
+    names.push_back("metric-" + std::to_string(i));
+    ASSERT_EQ(i, registry.Register(names.back(), *params));
+  }
+  names.push_back(std::string(5000, 'x'));  // longer than a name block
+  int long_handle = registry.Register(names.back(), *params);
+  int wide_handle = drbg_registry.Register("wide", wide_params);
+
+  ASSERT_EQ(301u, registry.size());
+  ASSERT_EQ(0u, registry.built());
+  ASSERT_EQ(7, registry.Register("metric-7", *params));
+  ASSERT_EQ(-1, registry.Find("unknown"));
+  ASSERT_EQ(nullptr, registry.Get("unknown"));
+  ASSERT_EQ(long_handle, registry.Find(names.back()));
+
+  for (const std::string& name : { names[0], names[299], names[300] }) {
+    rappor::Encoder expected(name, *params, *deps);
+    const rappor::Encoder* encoder = registry.Get(name);
+    ASSERT_NE(nullptr, encoder);
+    ASSERT_EQ(encoder, registry.Get(registry.Find(name)));
+    ASSERT_EQ(expected.cohort(), encoder->cohort());
+
+    rappor::Bits bloom, prr, irr;
+    rappor::Bits expected_bloom, expected_prr, expected_irr;
+    ASSERT_TRUE(expected._EncodeStringInternal("foo", &expected_bloom,
+                                               &expected_prr, &expected_irr));
+    ASSERT_TRUE(encoder->_EncodeStringInternal("foo", &bloom, &prr, &irr));
+    ASSERT_EQ(expected_bloom, bloom);
+    ASSERT_EQ(expected_prr, prr);
+    ASSERT_EQ(expected_irr, irr);
+  }
+  ASSERT_EQ(3u, registry.built());
+
+  rappor::Encoder expected_wide("wide", wide_params, drbg_deps);
+  rappor::Bits128 wide, expected;
+  ASSERT_TRUE(expected_wide.EncodeString("foo", &expected));
+  ASSERT_TRUE(drbg_registry.Get(wide_handle)->EncodeString("foo", &wide));
+  ASSERT_EQ(expected, wide);
+}
+
+// Standalone encoders keep their own client state, shared with copies;
+// neither depends on the Deps or id they were built from.
+TEST_F(EncoderUint32Test, EncoderCopyOutlivesSource) {
+  rappor::Bits expected;
+  ASSERT_TRUE(encoder->_EncodeBitsInternal(0x123, &expected, &bits_out));
+
+  auto temp_deps = std::make_unique<rappor::Deps>(
+      rappor::Md5, "client-secret", rappor::HmacSha256, irr_rand);
+  auto source = std::make_unique<rappor::Encoder>(
+      std::string(encoder_id), *params, *temp_deps);
+  temp_deps.reset();
+  rappor::Encoder copy(*source);
+  source.reset();
+
+  rappor::Bits prr;
+  ASSERT_TRUE(copy._EncodeBitsInternal(0x123, &prr, &bits_out));
+  ASSERT_EQ(expected, prr);
+}
+
+// Bad params fail at registration, not when the metric is first encoded.
+TEST_F(EncoderUint32Test, RegistryRegisterChecksParamsDeathTest) {
+  ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+  rappor::EncoderRegistry registry(*deps);
+  rappor::Params bad_cohorts(32, 2, 3, 0.25, 0.75, 0.5);
+  EXPECT_DEATH(registry.Register("metric", bad_cohorts),
+               "num_cohorts \\(3\\) must be a power of 2");
+}
+
+static bool FailingHash(const std::string&, std::vector<uint8_t>*) {
+  return false;
+}
+
+TEST_F(EncoderUint32Test, StaticEncoderHashFailure) {
+  rappor::Deps failing_deps(FailingHash, "client-secret", rappor::HmacSha256,
+                            irr_rand);
+  rappor::StaticEncoder<StaticParams> static_encoder(encoder_id,
+                                                     failing_deps);
+  ASSERT_FALSE(static_encoder.EncodeString("foo", &bits_out));
+}
+
+TEST_F(EncoderUint32Test, AsyncMatchesSync) {
+  QThreadPool pool;
+  rappor::AsyncEncoder async(encoder, &pool);
+
+  QFuture<rappor::Bits> string_future = async.EncodeStringAsync("foo");
+  QFuture<rappor::Bits> bits_future = async.EncodeBitsAsync(0x123);
+  string_future.waitForFinished();
+  bits_future.waitForFinished();
+  ASSERT_FALSE(string_future.isCanceled());
+  ASSERT_TRUE(encoder->EncodeString("foo", &bits_out));
+  ASSERT_EQ(bits_out, string_future.result());
+  ASSERT_FALSE(bits_future.isCanceled());
+  ASSERT_TRUE(encoder->EncodeBits(0x123, &bits_out));
+  ASSERT_EQ(bits_out, bits_future.result());
+
+  std::vector<std::string> values;
+  for (int i = 0; i < 101; ++i) {
+    values.push_back("value-" + std::to_string(i));
+  }
+  QFuture<QVector<rappor::Bits>> batch_future =
+      async.EncodeStringsAsync(values);
+  std::vector<rappor::Bits> expected(values.size());
+  ASSERT_TRUE(encoder->EncodeStrings(values.data(), values.size(),
+                                     expected.data()));
+  batch_future.waitForFinished();
+  ASSERT_FALSE(batch_future.isCanceled());
+  QVector<rappor::Bits> irrs = batch_future.result();
+  ASSERT_EQ(values.size(), static_cast<size_t>(irrs.size()));
+  for (size_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(expected[i], irrs[i]) << i;
+  }
+
+  QFuture<QVector<rappor::Bits>> empty_future = async.EncodeStringsAsync({});
+  empty_future.waitForFinished();
+  ASSERT_FALSE(empty_future.isCanceled());
+  ASSERT_TRUE(empty_future.result().isEmpty());
+}
+
+TEST_F(EncoderUint32Test, AsyncFailureCancels) {
+  rappor::Deps failing_deps(FailingHash, "client-secret", rappor::HmacSha256,
+                            irr_rand);
+  rappor::Encoder failing(encoder_id, *params, failing_deps);
+  QThreadPool pool;
+  rappor::AsyncEncoder async(&failing, &pool);
+
+  QFuture<rappor::Bits> future = async.EncodeStringAsync("foo");
+  QFuture<QVector<rappor::Bits>> batch_future =
+      async.EncodeStringsAsync({ "foo", "bar" });
+  future.waitForFinished();
+  batch_future.waitForFinished();
+  ASSERT_TRUE(future.isCanceled());
+  ASSERT_TRUE(batch_future.isCanceled());
+}
+
 // Negative tests.
 TEST_F(EncoderUnlimTest, NumBitsNotMultipleOf8DeathTest) {
   ::testing::FLAGS_gtest_death_test_style = "threadsafe";
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include <set>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "qt-rappor-client/kernel_rand_impl.h"
+#include "rand_test_util.h"
+
+// 5000 rounds of masks refill the thread buffer several times.
+TEST(KernelRandTest, GetMasksMatchesProbability) {
+  rappor::KernelRand rand;
+  for (float prob : { 0.25f, 0.5f, 0.75f, 0.1f }) {
+    EXPECT_NEAR(prob, rappor::SetFraction(rand, prob), 0.01) << prob;
+  }
+}
+
+TEST(KernelRandTest, MasksDoNotRepeat) {
+  rappor::KernelRand rand;
+  std::set<rappor::Bits> seen;
+  for (int i = 0; i < 10000; ++i) {
+    rappor::Bits mask;
+    rand.GetMask(0.5f, 32, &mask);
+    seen.insert(mask);
+  }
+  // 10000 draws from 2^32 values collide with probability ~1%.
+  EXPECT_GE(seen.size(), 9998u);
+}
+
+TEST(KernelRandTest, GetMasksClearsHighBits) {
+  rappor::KernelRand rand;
+  rappor::Bits p[2];
+  rappor::Bits q[2];
+  rand.GetMasks(1.0f, 1.0f, 40, p, q);
+  EXPECT_EQ(~rappor::Bits(0), p[0]);
+  EXPECT_EQ(0xffu, q[1]);
+  rand.GetMasks(0.0f, 0.5f, 12, p, q);
+  EXPECT_EQ(0u, p[0]);
+  EXPECT_EQ(0u, q[0] & ~0xfffu);
+}
+
+// Parent and child must not hand out the same buffered bytes after fork().
+TEST(KernelRandTest, ForkDiscardsBuffer) {
+  rappor::KernelRand rand;
+  rappor::Bits mask;
+  rand.GetMask(0.5f, 32, &mask);  // fill this thread's buffer
+
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    rappor::Bits child[8];
+    for (rappor::Bits& word : child) {
+      rand.GetMask(0.5f, 32, &word);
+    }
+    ssize_t written = write(fds[1], child, sizeof(child));
+    _exit(written == sizeof(child) ? 0 : 1);
+  }
+  rappor::Bits parent[8];
+  for (rappor::Bits& word : parent) {
+    rand.GetMask(0.5f, 32, &word);
+  }
+  rappor::Bits child[8];
+  ASSERT_EQ(ssize_t(sizeof(child)), read(fds[0], child, sizeof(child)));
+  int status = 0;
+  waitpid(pid, &status, 0);
+  close(fds[0]);
+  close(fds[1]);
+  EXPECT_NE(0, memcmp(parent, child, sizeof(parent)));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
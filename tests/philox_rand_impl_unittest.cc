@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "qt-rappor-client/philox.h"
+#include "qt-rappor-client/philox_rand_impl.h"
+#include "rand_test_util.h"
+
+namespace {
+
+struct Masks {
+  rappor::Bits p[4];
+  rappor::Bits q[4];
+};
+
+// Two reports' worth of 100-bit masks from a fresh generator.
+std::vector<Masks> Report(uint64_t seed, uint64_t client, uint32_t report) {
+  rappor::PhiloxRand rand(seed, client, report);
+  std::vector<Masks> masks(2);
+  for (Masks& m : masks) {
+    rand.GetMasks(0.75f, 0.25f, 100, m.p, m.q);
+  }
+  return masks;
+}
+
+bool operator==(const Masks& a, const Masks& b) {
+  for (int i = 0; i < 4; ++i) {
+    if (a.p[i] != b.p[i] || a.q[i] != b.q[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+// Known-answer vectors from the Random123 distribution.
+TEST(PhiloxTest, KnownAnswers) {
+  struct {
+    uint32_t key[2];
+    uint32_t counter[4];
+    uint32_t expected[4];
+  } cases[] = {
+    { { 0, 0 }, { 0, 0, 0, 0 },
+      { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+    { { 0xffffffff, 0xffffffff },
+      { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff },
+      { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+    { { 0xa4093822, 0x299f31d0 },
+      { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 },
+      { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } },
+  };
+  for (const auto& c : cases) {
+    uint32_t out[4];
+    rappor::Philox4x32(c.key, c.counter, 1, out);
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_EQ(c.expected[i], out[i]) << i;
+    }
+  }
+}
+
+TEST(PhiloxTest, VectorKernelMatchesScalar) {
+  const uint32_t key[2] = { 0x12345678, 0x9abcdef0 };
+  // A first counter word near the wrap, and block counts that leave a tail.
+  for (uint32_t first : { 0u, 0xfffffffau }) {
+    const uint32_t counter[4] = { first, 1, 2, 3 };
+    for (size_t blocks : { 1, 7, 8, 9, 24, 29 }) {
+      std::vector<uint32_t> expected(blocks * 4);
+      std::vector<uint32_t> actual(blocks * 4);
+      rappor::Philox4x32Scalar(key, counter, blocks, expected.data());
+      rappor::Philox4x32(key, counter, blocks, actual.data());
+      EXPECT_EQ(expected, actual) << first << " " << blocks;
+    }
+  }
+}
+
+TEST(PhiloxRandTest, PureFunctionOfSeedClientReport) {
+  std::vector<Masks> expected = Report(1, 2, 3);
+  EXPECT_TRUE(expected[0] == Report(1, 2, 3)[0]);
+  EXPECT_TRUE(expected[1] == Report(1, 2, 3)[1]);
+  EXPECT_FALSE(expected[0] == expected[1]);
+  EXPECT_FALSE(expected[0] == Report(9, 2, 3)[0]);
+  EXPECT_FALSE(expected[0] == Report(1, 9, 3)[0]);
+  EXPECT_FALSE(expected[0] == Report(1, 2, 9)[0]);
+
+  // Reports generated on other threads, in another order, are identical.
+  const int kReports = 64;
+  std::vector<std::vector<Masks>> serial(kReports);
+  std::vector<std::vector<Masks>> parallel(kReports);
+  for (int r = 0; r < kReports; ++r) {
+    serial[r] = Report(1, 2, r);
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (int r = kReports - 1 - t; r >= 0; r -= 4) {
+        parallel[r] = Report(1, 2, r);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (int r = 0; r < kReports; ++r) {
+    EXPECT_TRUE(serial[r][0] == parallel[r][0]) << r;
+    EXPECT_TRUE(serial[r][1] == parallel[r][1]) << r;
+  }
+}
+
+TEST(PhiloxRandTest, GetMasksMatchesProbability) {
+  for (float prob : { 0.25f, 0.5f, 0.75f, 0.1f }) {
+    double fraction = rappor::SetFraction(prob, 2000, [](int r) {
+      return rappor::PhiloxRand(42, rappor::PhiloxRand::ClientId("client"), r);
+    });
+    EXPECT_NEAR(prob, fraction, 0.01) << prob;
+  }
+}
+
+TEST(PhiloxRandTest, GetMasksClearsHighBits) {
+  rappor::PhiloxRand rand(1, 2, 3);
+  rappor::Bits p[2];
+  rappor::Bits q[2];
+  rand.GetMasks(1.0f, 1.0f, 40, p, q);
+  EXPECT_EQ(~rappor::Bits(0), p[0]);
+  EXPECT_EQ(0xffu, q[1]);
+  rand.GetMasks(0.0f, 0.5f, 12, p, q);
+  EXPECT_EQ(0u, p[0]);
+  EXPECT_EQ(0u, q[0] & ~0xfffu);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <thread>
+
+#include "qt-rappor-client/prefetch_rand_impl.h"
+
+namespace {
+
+// Hands out numbered masks so the test can see where each pair came from.
+class CountingRand : public rappor::IrrRandInterface {
+ public:
+  void GetMask(float, int, rappor::Bits* mask_out) const override {
+    *mask_out = next_.fetch_add(1);
+  }
+  void GetMasks(float, float, int num_bits, rappor::Bits* p_out,
+                rappor::Bits* q_out) const override {
+    for (int i = 0; i < (num_bits + 31) / 32; ++i) {
+      p_out[i] = next_.fetch_add(1);
+      q_out[i] = ~p_out[i];
+    }
+  }
+  mutable std::atomic<rappor::Bits> next_{1};
+};
+
+void WaitForOccupancy(const rappor::PrefetchRand& rand, size_t occupancy) {
+  for (int i = 0; i < 500 && rand.stats().occupancy < occupancy; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
+
+}  // namespace
+
+TEST(PrefetchRandTest, ServesEachPairOnce) {
+  auto source = std::make_shared<CountingRand>();
+  rappor::PrefetchRand rand(source, 16);
+
+  const int kCalls = 200;
+  std::set<rappor::Bits> seen;
+  for (int i = 0; i < kCalls; ++i) {
+    rappor::Bits p[2];
+    rappor::Bits q[2];
+    rand.GetMasks(0.25f, 0.75f, 64, p, q);
+    EXPECT_EQ(~p[0], q[0]);
+    EXPECT_EQ(~p[1], q[1]);
+    EXPECT_TRUE(seen.insert(p[0]).second);
+    EXPECT_TRUE(seen.insert(p[1]).second);
+  }
+
+  rappor::PrefetchRand::Stats stats = rand.stats();
+  EXPECT_EQ(uint64_t(kCalls), stats.prefetched + stats.underflows);
+  EXPECT_GE(stats.refilled, stats.prefetched);
+  EXPECT_EQ(16u, stats.capacity);
+}
+
+TEST(PrefetchRandTest, RefillsInBackground) {
+  auto source = std::make_shared<CountingRand>();
+  rappor::PrefetchRand rand(source, 8);
+  rappor::Bits p = 0;
+  rappor::Bits q = 0;
+
+  // The first call creates the ring, so it can only be an underflow.
+  rand.GetMasks(0.5f, 0.5f, 16, &p, &q);
+  EXPECT_EQ(1u, rand.stats().underflows);
+
+  WaitForOccupancy(rand, 8);
+  EXPECT_EQ(8u, rand.stats().occupancy);
+  for (int i = 0; i < 4; ++i) {
+    rand.GetMasks(0.5f, 0.5f, 16, &p, &q);
+  }
+  EXPECT_EQ(4u, rand.stats().prefetched);
+  EXPECT_EQ(1u, rand.stats().underflows);
+
+  // Other parameters get their own ring.
+  rand.GetMasks(0.1f, 0.5f, 16, &p, &q);
+  WaitForOccupancy(rand, 16);
+  EXPECT_EQ(16u, rand.stats().capacity);
+}
+
+TEST(PrefetchRandTest, WideMasksPassThrough) {
+  auto source = std::make_shared<CountingRand>();
+  rappor::PrefetchRand rand(source, 8);
+  rappor::Bits p[4];
+  rappor::Bits q[4];
+  rand.GetMasks(0.5f, 0.5f, 128, p, q);
+  EXPECT_EQ(1u, p[0]);
+  EXPECT_EQ(0u, rand.stats().capacity);
+  EXPECT_EQ(0u, rand.stats().underflows);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,6 +1,13 @@
 #include <gtest/gtest.h>
 
+#include <string.h>
+
+#include <QCryptographicHash>
+#include <QMessageAuthenticationCode>
+
+#include "qt-rappor-client/md5.h"
 #include "qt-rappor-client/qt_hash_impl.h"
+#include "qt-rappor-client/sha256.h"
 
 
 TEST(OpensslHashImplTest, Md5) {
@@ -139,6 +146,251 @@ TEST(OpensslHashImplTest, HmacDrbgTextStrings) {
   ASSERT_EQ(expected, output);
 }
 
+// The in-house HMAC must be byte-compatible with Qt's, across block
+// boundaries and for keys longer than a block.
+TEST(OpensslHashImplTest, HmacSha256Context) {
+  const std::string keys[] = { "", "key", std::string(64, 'k'),
+                               std::string(65, 'k'), std::string(200, 'k') };
+  for (const std::string& key : keys) {
+    for (size_t len : { 0, 1, 4, 55, 56, 63, 64, 65, 119, 120, 1000 }) {
+      std::string value;
+      for (size_t i = 0; i < len; ++i) {
+        value.push_back(static_cast<char>(i * 31));
+      }
+      const QByteArray qt = QMessageAuthenticationCode::hash(
+          QByteArray::fromStdString(value), QByteArray::fromStdString(key),
+          QCryptographicHash::Sha256);
+      std::vector<uint8_t> expected(qt.begin(), qt.end());
+
+      // Split the message to exercise partial-block buffering.
+      rappor::HmacSha256Context hmac(key);
+      hmac.Update(value.data(), len / 3);
+      rappor::HmacSha256Context midstate(hmac);
+      midstate.Update(value.data() + len / 3, len - len / 3);
+      std::vector<uint8_t> output(rappor::Sha256Context::kDigestSize);
+      midstate.Final(output.data());
+      ASSERT_EQ(expected, output) << "key " << key.size() << " len " << len;
+    }
+  }
+}
+
+// RFC 1321 test suite.
+TEST(OpensslHashImplTest, Md5Vectors) {
+  const struct {
+    const char* message;
+    const char* digest;
+  } cases[] = {
+    { "", "d41d8cd98f00b204e9800998ecf8427e" },
+    { "a", "0cc175b9c0f1b6a831c399e269772661" },
+    { "abc", "900150983cd24fb0d6963f7d28e17f72" },
+    { "message digest", "f96b697d7cb7938d525a2f31aaf161d0" },
+    { "abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b" },
+    { "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+      "d174ab98d277d9f5a5611c2c9f419d9f" },
+    { "1234567890123456789012345678901234567890"
+      "1234567890123456789012345678901234567890",
+      "57edf4a22be3c955ac49da2e2107b67a" },
+  };
+  for (const auto& c : cases) {
+    uint8_t digest[rappor::Md5Context::kDigestSize];
+    rappor::Md5Context::Hash(c.message, strlen(c.message), digest);
+    char hex[2 * sizeof(digest) + 1];
+    for (size_t i = 0; i < sizeof(digest); ++i) {
+      snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+    }
+    EXPECT_STREQ(c.digest, hex) << c.message;
+  }
+}
+
+// The one-shot and incremental paths must agree with Qt around the padding
+// cutoff and across block boundaries.
+TEST(OpensslHashImplTest, Md5MatchesQt) {
+  for (size_t len : { 0, 1, 54, 55, 56, 57, 63, 64, 65, 119, 120, 1000 }) {
+    std::string value;
+    for (size_t i = 0; i < len; ++i) {
+      value.push_back(static_cast<char>(i * 13 + 5));
+    }
+    const QByteArray qt = QCryptographicHash::hash(
+        QByteArray::fromStdString(value), QCryptographicHash::Md5);
+    std::vector<uint8_t> expected(qt.begin(), qt.end());
+
+    std::vector<uint8_t> one_shot(rappor::Md5Context::kDigestSize);
+    rappor::Md5Context::Hash(value.data(), len, one_shot.data());
+    EXPECT_EQ(expected, one_shot) << len;
+
+    rappor::Md5Context md5;
+    md5.Update(value.data(), len / 3);
+    md5.Update(value.data() + len / 3, len - len / 3);
+    std::vector<uint8_t> incremental(rappor::Md5Context::kDigestSize);
+    md5.Final(incremental.data());
+    EXPECT_EQ(expected, incremental) << len;
+  }
+}
+
+// FIPS 180-2 test vectors, through whichever compression function the CPU
+// selects.
+TEST(OpensslHashImplTest, Sha256Vectors) {
+  const struct {
+    std::string message;
+    const char* digest;
+  } cases[] = {
+    { "abc",
+      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+    { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+      "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+    { std::string(1000000, 'a'),
+      "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" },
+  };
+  for (const auto& c : cases) {
+    rappor::Sha256Context sha;
+    sha.Update(c.message.data(), c.message.size());
+    uint8_t digest[rappor::Sha256Context::kDigestSize];
+    sha.Final(digest);
+    char hex[2 * sizeof(digest) + 1];
+    for (size_t i = 0; i < sizeof(digest); ++i) {
+      snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+    }
+    EXPECT_STREQ(c.digest, hex);
+  }
+}
+
+TEST(OpensslHashImplTest, Sha256CompressMatchesScalar) {
+  uint8_t blocks[9 * rappor::Sha256Context::kBlockSize];
+  for (size_t i = 0; i < sizeof(blocks); ++i) {
+    blocks[i] = static_cast<uint8_t>(i * 151 + 7);
+  }
+  for (size_t num_blocks = 1; num_blocks <= 9; ++num_blocks) {
+    uint32_t expected[8];
+    uint32_t actual[8];
+    for (int i = 0; i < 8; ++i) {
+      expected[i] = actual[i] = 0x01234567u * (i + 1);
+    }
+    rappor::Sha256CompressScalar(expected, blocks, num_blocks);
+    rappor::Sha256Compress(actual, blocks, num_blocks);
+    EXPECT_EQ(0, memcmp(expected, actual, sizeof(actual))) << num_blocks;
+  }
+}
+
+TEST(OpensslHashImplTest, Sha256CompressLanesMatchesScalar) {
+  // 27 lanes: one 16-lane group, one 8-lane group and 3 single lanes.
+  const size_t kLanes = 27;
+  std::vector<uint8_t> data(kLanes * rappor::Sha256Context::kBlockSize);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<uint8_t>(i * 89 + 11);
+  }
+  std::vector<uint32_t> expected(kLanes * 8);
+  std::vector<uint32_t> actual(kLanes * 8);
+  const uint8_t* blocks[kLanes];
+  for (size_t l = 0; l < kLanes; ++l) {
+    blocks[l] = data.data() + l * rappor::Sha256Context::kBlockSize;
+    for (int i = 0; i < 8; ++i) {
+      expected[8 * l + i] = actual[8 * l + i] =
+          rappor::kSha256InitialState[i] + static_cast<uint32_t>(l);
+    }
+    rappor::Sha256CompressScalar(&expected[8 * l], blocks[l], 1);
+  }
+  rappor::Sha256CompressLanes(actual.data(), blocks, kLanes);
+  EXPECT_EQ(expected, actual);
+}
+
+// Mixed key and message lengths, so lanes finish after different numbers of
+// blocks and groups are only partly full.
+TEST(OpensslHashImplTest, HmacSha256BatchMatchesInto) {
+  const size_t kCount = 37;
+  std::vector<std::string> key_storage;
+  std::vector<std::string> value_storage;
+  for (size_t i = 0; i < kCount; ++i) {
+    key_storage.push_back(std::string((i * 23) % 101, static_cast<char>('a' + i % 26)));
+    std::string value;
+    for (size_t j = 0; j < (i * 37) % 200; ++j) {
+      value.push_back(static_cast<char>(i + j * 7));
+    }
+    value_storage.push_back(value);
+  }
+  std::vector<std::string_view> keys(key_storage.begin(), key_storage.end());
+  std::vector<std::string_view> values(value_storage.begin(),
+                                       value_storage.end());
+
+  std::vector<rappor::HmacDigest> batch(kCount);
+  ASSERT_TRUE(rappor::HmacSha256Batch(keys.data(), values.data(), kCount,
+                                      batch.data()));
+  for (size_t i = 0; i < kCount; ++i) {
+    rappor::HmacDigest expected;
+    ASSERT_TRUE(rappor::HmacSha256Into(keys[i], values[i], &expected));
+    EXPECT_EQ(expected, batch[i]) << "key " << keys[i].size() << " value "
+                                  << values[i].size();
+  }
+}
+
+TEST(OpensslHashImplTest, Md5CompressLanesMatchesScalar) {
+  // 31 lanes: one group each of 16, 8 and 4 lanes, and 3 single lanes.
+  const size_t kLanes = 31;
+  std::vector<uint8_t> data(kLanes * rappor::Md5Context::kBlockSize);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<uint8_t>(i * 89 + 11);
+  }
+  std::vector<uint32_t> expected(kLanes * 4);
+  std::vector<uint32_t> actual(kLanes * 4);
+  const uint8_t* blocks[kLanes];
+  for (size_t l = 0; l < kLanes; ++l) {
+    blocks[l] = data.data() + l * rappor::Md5Context::kBlockSize;
+    for (int i = 0; i < 4; ++i) {
+      expected[4 * l + i] = actual[4 * l + i] =
+          rappor::kMd5InitialState[i] + static_cast<uint32_t>(l);
+    }
+    rappor::Md5Compress(&expected[4 * l], blocks[l], 1);
+  }
+  rappor::Md5CompressLanes(actual.data(), blocks, kLanes);
+  EXPECT_EQ(expected, actual);
+}
+
+// Lengths around the padding boundaries, so lanes finish after different
+// numbers of blocks and groups are only partly full.
+TEST(OpensslHashImplTest, Md5BatchMatchesContext) {
+  std::vector<std::string> storage;
+  for (size_t len = 0; len < 140; len += 3) {
+    std::string value;
+    for (size_t j = 0; j < len; ++j) {
+      value.push_back(static_cast<char>(len + j * 13));
+    }
+    storage.push_back(value);
+  }
+  for (size_t len : { 55, 56, 63, 64, 119, 120 }) {
+    storage.push_back(std::string(len, 'x'));
+  }
+  std::vector<std::string_view> values(storage.begin(), storage.end());
+
+  std::vector<rappor::HashDigest> batch(values.size());
+  ASSERT_TRUE(rappor::Md5Batch(values.data(), values.size(), batch.data()));
+  for (size_t i = 0; i < values.size(); ++i) {
+    rappor::HashDigest expected;
+    rappor::Md5Context::Hash(values[i].data(), values[i].size(),
+                             expected.data());
+    EXPECT_EQ(expected, batch[i]) << "value " << values[i].size();
+  }
+}
+
+TEST(OpensslHashImplTest, IntoMatchesVector) {
+  for (size_t len : { 0, 1, 4, 55, 56, 63, 64, 65, 1000 }) {
+    std::string value;
+    for (size_t i = 0; i < len; ++i) {
+      value.push_back(static_cast<char>(i * 7));
+    }
+
+    std::vector<uint8_t> md5;
+    rappor::Md5(value, &md5);
+    rappor::HashDigest md5_into;
+    ASSERT_TRUE(rappor::Md5Into(value, &md5_into));
+    ASSERT_EQ(md5, std::vector<uint8_t>(md5_into.begin(), md5_into.end()));
+
+    std::vector<uint8_t> hmac;
+    rappor::HmacSha256("key", value, &hmac);
+    rappor::HmacDigest hmac_into;
+    ASSERT_TRUE(rappor::HmacSha256Into("key", value, &hmac_into));
+    ASSERT_EQ(hmac, std::vector<uint8_t>(hmac_into.begin(), hmac_into.end()));
+  }
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+
+#include "qt-rappor-client/rappor_deps.h"
+
+namespace rappor {
+
+// Fraction of set bits in the p masks of 'rounds' 128-bit GetMasks() calls
+// with prob_p = prob.  get_rand(i) returns the generator for call i, either
+// by reference or, for single-use generators, a fresh one by value.
+template <typename GetRand>
+double SetFraction(float prob, int rounds, GetRand get_rand) {
+  const int kWords = 4;
+  Bits p[kWords];
+  Bits q[kWords];
+  size_t set = 0;
+  for (int i = 0; i < rounds; ++i) {
+    const auto& rand = get_rand(i);
+    rand.GetMasks(prob, 1.0f - prob, kWords * 32, p, q);
+    for (int w = 0; w < kWords; ++w) {
+      set += std::bitset<32>(p[w]).count();
+    }
+  }
+  return static_cast<double>(set) / (static_cast<double>(rounds) * kWords * 32);
+}
+
+// The same, with every call on one generator.
+inline double SetFraction(const IrrRandInterface& rand, float prob,
+                          int rounds = 5000) {
+  return SetFraction(prob, rounds,
+                     [&rand](int) -> const IrrRandInterface& { return rand; });
+}
+
+}  // namespace rappor
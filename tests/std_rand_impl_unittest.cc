@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+
+
+#include "qt-rappor-client/std_rand_impl.h"
+#include "rand_test_util.h"
+
+TEST(StdRandTest, GetMasksMatchesProbability) {
+  rappor::StdRand rand(42);
+  for (float prob : { 0.25f, 0.5f, 0.75f, 0.1f }) {
+    EXPECT_NEAR(prob, rappor::SetFraction(rand, prob), 0.01) << prob;
+  }
+}
+
+TEST(StdRandTest, GetMasksExtremes) {
+  rappor::StdRand rand(42);
+  rappor::Bits p[2];
+  rappor::Bits q[2];
+  rand.GetMasks(0.0f, 1.0f, 64, p, q);
+  EXPECT_EQ(0u, p[0] | p[1]);
+  EXPECT_EQ(~rappor::Bits(0), q[0] & q[1]);
+}
+
+TEST(StdRandTest, GetMasksClearsHighBits) {
+  rappor::StdRand rand(42);
+  rappor::Bits p[2];
+  rappor::Bits q[2];
+  rand.GetMasks(1.0f, 1.0f, 40, p, q);
+  EXPECT_EQ(~rappor::Bits(0), p[0]);
+  EXPECT_EQ(0xffu, p[1]);
+  EXPECT_EQ(0xffu, q[1]);
+
+  rappor::Bits mask;
+  rand.GetMask(1.0f, 12, &mask);
+  EXPECT_EQ(0xfffu, mask);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}